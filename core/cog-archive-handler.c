@@ -0,0 +1,464 @@
+/*
+ * cog-archive-handler.c
+ * Copyright (C) 2023 Igalia S.L.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "cog-archive-handler.h"
+
+#include <gio/gio.h>
+#include <string.h>
+
+/**
+ * CogArchiveHandler:
+ *
+ * Request handler implementation that loads content from a single
+ * archive file.
+ *
+ * Serving many small files from a directory tree needs querying
+ * information about each file and opening it, which can be slow on
+ * some storage devices. This handler instead loads an archive, which
+ * is mapped into memory once and contains a sorted index of paths
+ * along with their contents and MIME types. Requests are answered
+ * using slices of the mapped file, without copying.
+ *
+ * Only the path component of requested URIs is taken into account.
+ * Paths which end in a slash, or which match no entry, are also
+ * looked up with `index.html` appended.
+ *
+ * ## Archive Format
+ *
+ * All integers are stored in little endian byte order. Archives start
+ * with a header:
+ *
+ * | Offset | Type        | Contents                      |
+ * |-------:|:------------|:------------------------------|
+ * |      0 | `char[8]`   | Magic: `CogPack` followed by a NUL byte |
+ * |      8 | `uint32_t`  | Version, must be `1`          |
+ * |     12 | `uint32_t`  | Number of entries             |
+ *
+ * The header is followed by the entries, of 32 bytes each, sorted by
+ * comparing their paths byte by byte:
+ *
+ * | Offset | Type        | Contents                      |
+ * |-------:|:------------|:------------------------------|
+ * |      0 | `uint64_t`  | Offset of the contents        |
+ * |      8 | `uint64_t`  | Size of the contents          |
+ * |     16 | `uint32_t`  | Offset of the path            |
+ * |     20 | `uint32_t`  | Length of the path            |
+ * |     24 | `uint32_t`  | Offset of the MIME type       |
+ * |     28 | `uint32_t`  | Length of the MIME type       |
+ *
+ * Offsets are relative to the start of the file. Paths are relative,
+ * without a leading slash, and strings are not NUL-terminated. The MIME
+ * type may be empty, in which case it is guessed from the path. The
+ * `cog-mkarchive.py` script distributed with Cog can be used to create
+ * archives.
+ *
+ * Since: 0.20
+ */
+
+#define ARCHIVE_MAGIC       "CogPack"
+#define ARCHIVE_VERSION     1
+#define ARCHIVE_HEADER_SIZE 16
+#define ARCHIVE_ENTRY_SIZE  32
+
+typedef struct {
+    guint64     data_offset;
+    guint64     data_size;
+    const char *path;
+    guint32     path_length;
+    const char *mime_type;
+    guint32     mime_type_length;
+} ArchiveEntry;
+
+struct _CogArchiveHandler {
+    GObject parent;
+
+    GFile  *file;
+    GBytes *contents;
+
+    const guint8 *data;
+    gsize         size;
+    guint32       n_entries;
+};
+
+enum {
+    PROP_0,
+    PROP_FILE,
+    N_PROPERTIES,
+};
+
+static GParamSpec *s_properties[N_PROPERTIES] = {
+    NULL,
+};
+
+static void cog_archive_handler_initable_iface_init(GInitableIface *iface);
+static void cog_archive_handler_iface_init(CogRequestHandlerInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(CogArchiveHandler,
+                        cog_archive_handler,
+                        G_TYPE_OBJECT,
+                        G_IMPLEMENT_INTERFACE(G_TYPE_INITABLE, cog_archive_handler_initable_iface_init)
+                            G_IMPLEMENT_INTERFACE(COG_TYPE_REQUEST_HANDLER, cog_archive_handler_iface_init))
+
+G_DEFINE_QUARK(CogArchiveHandlerError, cog_archive_handler_error)
+
+static inline guint32
+read_uint32(const guint8 *p)
+{
+    guint32 value;
+    memcpy(&value, p, sizeof(value));
+    return GUINT32_FROM_LE(value);
+}
+
+static inline guint64
+read_uint64(const guint8 *p)
+{
+    guint64 value;
+    memcpy(&value, p, sizeof(value));
+    return GUINT64_FROM_LE(value);
+}
+
+static void
+cog_archive_handler_get_entry(CogArchiveHandler *self, guint32 index, ArchiveEntry *entry)
+{
+    const guint8 *p = self->data + ARCHIVE_HEADER_SIZE + (gsize) index * ARCHIVE_ENTRY_SIZE;
+
+    entry->data_offset = read_uint64(p);
+    entry->data_size = read_uint64(p + 8);
+    entry->path = (const char *) self->data + read_uint32(p + 16);
+    entry->path_length = read_uint32(p + 20);
+    entry->mime_type = (const char *) self->data + read_uint32(p + 24);
+    entry->mime_type_length = read_uint32(p + 28);
+}
+
+static inline gboolean
+range_is_valid(CogArchiveHandler *self, guint64 offset, guint64 length)
+{
+    return offset <= self->size && length <= self->size - offset;
+}
+
+static int
+compare_path(const char *a, gsize a_length, const char *b, gsize b_length)
+{
+    int result = memcmp(a, b, MIN(a_length, b_length));
+    if (result != 0)
+        return result;
+    return (a_length > b_length) - (a_length < b_length);
+}
+
+/*
+ * All the entries are validated once when loading the archive, so
+ * lookups can be done later on without further bounds checking.
+ */
+static gboolean
+cog_archive_handler_validate(CogArchiveHandler *self, GError **error)
+{
+    if (self->size < ARCHIVE_HEADER_SIZE || memcmp(self->data, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0) {
+        g_set_error_literal(error, COG_ARCHIVE_HANDLER_ERROR, COG_ARCHIVE_HANDLER_ERROR_INVALID,
+                            "Not an archive file");
+        return FALSE;
+    }
+
+    const guint32 version = read_uint32(self->data + 8);
+    if (version != ARCHIVE_VERSION) {
+        g_set_error(error, COG_ARCHIVE_HANDLER_ERROR, COG_ARCHIVE_HANDLER_ERROR_INVALID,
+                    "Unsupported archive version %" G_GUINT32_FORMAT, version);
+        return FALSE;
+    }
+
+    self->n_entries = read_uint32(self->data + 12);
+    if (!range_is_valid(self, ARCHIVE_HEADER_SIZE, (guint64) self->n_entries * ARCHIVE_ENTRY_SIZE)) {
+        g_set_error_literal(error, COG_ARCHIVE_HANDLER_ERROR, COG_ARCHIVE_HANDLER_ERROR_INVALID,
+                            "Archive index is truncated");
+        return FALSE;
+    }
+
+    ArchiveEntry previous = {};
+    for (guint32 i = 0; i < self->n_entries; i++) {
+        const guint8 *p = self->data + ARCHIVE_HEADER_SIZE + (gsize) i * ARCHIVE_ENTRY_SIZE;
+        if (!range_is_valid(self, read_uint64(p), read_uint64(p + 8)) ||
+            !range_is_valid(self, read_uint32(p + 16), read_uint32(p + 20)) ||
+            !range_is_valid(self, read_uint32(p + 24), read_uint32(p + 28))) {
+            g_set_error(error, COG_ARCHIVE_HANDLER_ERROR, COG_ARCHIVE_HANDLER_ERROR_INVALID,
+                        "Archive entry #%" G_GUINT32_FORMAT " is out of bounds", i);
+            return FALSE;
+        }
+
+        ArchiveEntry entry;
+        cog_archive_handler_get_entry(self, i, &entry);
+        if (i > 0 && compare_path(previous.path, previous.path_length, entry.path, entry.path_length) >= 0) {
+            g_set_error(error, COG_ARCHIVE_HANDLER_ERROR, COG_ARCHIVE_HANDLER_ERROR_INVALID,
+                        "Archive entry #%" G_GUINT32_FORMAT " is not sorted", i);
+            return FALSE;
+        }
+        previous = entry;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+cog_archive_handler_lookup(CogArchiveHandler *self, const char *path, gsize path_length, ArchiveEntry *entry)
+{
+    guint32 low = 0, high = self->n_entries;
+    while (low < high) {
+        const guint32 middle = low + (high - low) / 2;
+        cog_archive_handler_get_entry(self, middle, entry);
+
+        int result = compare_path(path, path_length, entry->path, entry->path_length);
+        if (result == 0)
+            return TRUE;
+        if (result < 0)
+            high = middle;
+        else
+            low = middle + 1;
+    }
+    return FALSE;
+}
+
+static gboolean
+cog_archive_handler_lookup_with_index(CogArchiveHandler *self, const char *path, ArchiveEntry *entry)
+{
+    const gsize path_length = strlen(path);
+    if (path_length > 0 && path[path_length - 1] != '/' && cog_archive_handler_lookup(self, path, path_length, entry))
+        return TRUE;
+
+    g_autofree char *index_path = (path_length == 0 || path[path_length - 1] == '/')
+                                      ? g_strconcat(path, "index.html", NULL)
+                                      : g_strconcat(path, "/index.html", NULL);
+    return cog_archive_handler_lookup(self, index_path, strlen(index_path), entry);
+}
+
+static void
+cog_archive_handler_run(CogRequestHandler *request_handler, WebKitURISchemeRequest *request)
+{
+    CogArchiveHandler *self = COG_ARCHIVE_HANDLER(request_handler);
+
+    /*
+     * If we get an empty path, redirect to the root resource "/", otherwise
+     * subresources cannot load properly as there would be no base URI.
+     */
+    const char *request_path = webkit_uri_scheme_request_get_path(request);
+    if (!request_path || request_path[0] != '/') {
+        g_autofree char *uri_string = g_strconcat(webkit_uri_scheme_request_get_uri(request), "/", NULL);
+        webkit_web_view_load_uri(webkit_uri_scheme_request_get_web_view(request), uri_string);
+        return;
+    }
+
+    g_autofree char *path = g_uri_unescape_string(request_path, NULL);
+    if (!path) {
+        g_autoptr(GError) error =
+            g_error_new(G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT, "Invalid URI path: %s", request_path);
+        webkit_uri_scheme_request_finish_error(request, error);
+        return;
+    }
+
+    /* Entries are stored without the leading slash. */
+    const char *relative_path = path;
+    while (relative_path[0] == '/')
+        ++relative_path;
+
+    ArchiveEntry entry;
+    if (!cog_archive_handler_lookup_with_index(self, relative_path, &entry)) {
+        g_autoptr(GError) error = g_error_new(G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "Path '%s' not found in archive '%s'",
+                                              path, g_file_peek_path(self->file));
+        webkit_uri_scheme_request_finish_error(request, error);
+        return;
+    }
+
+    g_autofree char *mime_type = NULL;
+    if (entry.mime_type_length) {
+        mime_type = g_strndup(entry.mime_type, entry.mime_type_length);
+    } else {
+        g_autofree char *entry_path = g_strndup(entry.path, entry.path_length);
+        mime_type = g_content_type_guess(entry_path, NULL, 0, NULL);
+    }
+
+    g_autoptr(GBytes) contents = g_bytes_new_from_bytes(self->contents, entry.data_offset, entry.data_size);
+    g_autoptr(GInputStream) stream = g_memory_input_stream_new_from_bytes(contents);
+    webkit_uri_scheme_request_finish(request, stream, entry.data_size, mime_type);
+}
+
+static void
+cog_archive_handler_iface_init(CogRequestHandlerInterface *iface)
+{
+    iface->run = cog_archive_handler_run;
+}
+
+static gboolean
+cog_archive_handler_initable_init(GInitable *initable, GCancellable *cancellable G_GNUC_UNUSED, GError **error)
+{
+    CogArchiveHandler *self = COG_ARCHIVE_HANDLER(initable);
+
+    if (!self->file) {
+        g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT, "No archive file specified");
+        return FALSE;
+    }
+
+    g_autofree char *path = g_file_get_path(self->file);
+    if (!path) {
+        g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Archive file is not native");
+        return FALSE;
+    }
+
+    g_autoptr(GMappedFile) mapped_file = g_mapped_file_new(path, FALSE, error);
+    if (!mapped_file)
+        return FALSE;
+
+    self->contents = g_mapped_file_get_bytes(mapped_file);
+    self->data = g_bytes_get_data(self->contents, &self->size);
+
+    if (!cog_archive_handler_validate(self, error)) {
+        g_prefix_error(error, "%s: ", path);
+        g_clear_pointer(&self->contents, g_bytes_unref);
+        self->data = NULL;
+        self->size = 0;
+        self->n_entries = 0;
+        return FALSE;
+    }
+
+    g_debug("%s: Archive '%s', %" G_GUINT32_FORMAT " entries", G_STRFUNC, path, self->n_entries);
+    return TRUE;
+}
+
+static void
+cog_archive_handler_initable_iface_init(GInitableIface *iface)
+{
+    iface->init = cog_archive_handler_initable_init;
+}
+
+static void
+cog_archive_handler_get_property(GObject *object, unsigned prop_id, GValue *value, GParamSpec *pspec)
+{
+    CogArchiveHandler *self = COG_ARCHIVE_HANDLER(object);
+    switch (prop_id) {
+    case PROP_FILE:
+        g_value_set_object(value, self->file);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    }
+}
+
+static void
+cog_archive_handler_set_property(GObject *object, unsigned prop_id, const GValue *value, GParamSpec *pspec)
+{
+    CogArchiveHandler *self = COG_ARCHIVE_HANDLER(object);
+    switch (prop_id) {
+    case PROP_FILE:
+        g_clear_object(&self->file);
+        self->file = g_value_dup_object(value);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    }
+}
+
+static void
+cog_archive_handler_dispose(GObject *object)
+{
+    CogArchiveHandler *self = COG_ARCHIVE_HANDLER(object);
+
+    g_clear_object(&self->file);
+
+    G_OBJECT_CLASS(cog_archive_handler_parent_class)->dispose(object);
+}
+
+static void
+cog_archive_handler_finalize(GObject *object)
+{
+    CogArchiveHandler *self = COG_ARCHIVE_HANDLER(object);
+
+    /* Responses still being read keep their own reference to the mapping. */
+    g_clear_pointer(&self->contents, g_bytes_unref);
+
+    G_OBJECT_CLASS(cog_archive_handler_parent_class)->finalize(object);
+}
+
+static void
+cog_archive_handler_class_init(CogArchiveHandlerClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS(klass);
+    object_class->get_property = cog_archive_handler_get_property;
+    object_class->set_property = cog_archive_handler_set_property;
+    object_class->dispose = cog_archive_handler_dispose;
+    object_class->finalize = cog_archive_handler_finalize;
+
+    /**
+     * CogArchiveHandler:file: (attributes org.gtk.Property.get=cog_archive_handler_get_file)
+     *
+     * Archive file from which to load resources.
+     *
+     * Since: 0.20
+     */
+    s_properties[PROP_FILE] = g_param_spec_object("file", NULL, NULL, G_TYPE_FILE,
+                                                  G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+
+    g_object_class_install_properties(object_class, N_PROPERTIES, s_properties);
+}
+
+static void
+cog_archive_handler_init(CogArchiveHandler *self G_GNUC_UNUSED)
+{
+}
+
+/**
+ * cog_archive_handler_new: (constructor)
+ * @file: Archive file.
+ * @error: Location where to store an error on failure.
+ *
+ * Create a new handler which serves resources from an archive.
+ *
+ * The archive is mapped into memory and its index validated before
+ * returning.
+ *
+ * Returns: (transfer full) (nullable): A new archive handler, or %NULL
+ *    if the archive cannot be loaded.
+ *
+ * Since: 0.20
+ */
+CogRequestHandler *
+cog_archive_handler_new(GFile *file, GError **error)
+{
+    g_return_val_if_fail(G_IS_FILE(file), NULL);
+    g_return_val_if_fail(!error || !*error, NULL);
+
+    return g_initable_new(COG_TYPE_ARCHIVE_HANDLER, NULL, error, "file", file, NULL);
+}
+
+/**
+ * cog_archive_handler_get_file:
+ * @self: an archive handler.
+ *
+ * Gets the archive file used by the handler.
+ *
+ * Returns: (transfer none): Archive file.
+ *
+ * Since: 0.20
+ */
+GFile *
+cog_archive_handler_get_file(CogArchiveHandler *self)
+{
+    g_return_val_if_fail(COG_IS_ARCHIVE_HANDLER(self), NULL);
+    return self->file;
+}
+
+/**
+ * cog_archive_handler_get_n_entries:
+ * @self: an archive handler.
+ *
+ * Gets the number of entries contained in the archive.
+ *
+ * Returns: Number of entries.
+ *
+ * Since: 0.20
+ */
+unsigned
+cog_archive_handler_get_n_entries(CogArchiveHandler *self)
+{
+    g_return_val_if_fail(COG_IS_ARCHIVE_HANDLER(self), 0);
+    return self->n_entries;
+}
@@ -0,0 +1,50 @@
+/*
+ * cog-archive-handler.h
+ * Copyright (C) 2023 Igalia S.L.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#if !(defined(COG_INSIDE_COG__) && COG_INSIDE_COG__)
+#    error "Do not include this header directly, use <cog.h> instead"
+#endif
+
+#include "cog-export.h"
+#include "cog-request-handler.h"
+
+G_BEGIN_DECLS
+
+#define COG_TYPE_ARCHIVE_HANDLER (cog_archive_handler_get_type())
+
+COG_API
+G_DECLARE_FINAL_TYPE(CogArchiveHandler, cog_archive_handler, COG, ARCHIVE_HANDLER, GObject)
+
+struct _CogArchiveHandlerClass {
+    GObjectClass parent_class;
+};
+
+/**
+ * CogArchiveHandlerError:
+ * @COG_ARCHIVE_HANDLER_ERROR_INVALID: The archive file is not valid.
+ *
+ * Errors produced when loading archives.
+ *
+ * Since: 0.20
+ */
+typedef enum {
+    COG_ARCHIVE_HANDLER_ERROR_INVALID,
+} CogArchiveHandlerError;
+
+#define COG_ARCHIVE_HANDLER_ERROR (cog_archive_handler_error_quark())
+
+COG_API GQuark cog_archive_handler_error_quark(void);
+
+COG_API CogRequestHandler *cog_archive_handler_new(GFile *file, GError **error);
+
+COG_API GFile *cog_archive_handler_get_file(CogArchiveHandler *self);
+
+COG_API unsigned cog_archive_handler_get_n_entries(CogArchiveHandler *self);
+
+G_END_DECLS
@@ -5,8 +5,18 @@
  * SPDX-License-Identifier: MIT
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include "cog-directory-files-handler.h"
+#include "cog-request-handler-private.h"
+#include <errno.h>
+#include <fcntl.h>
 #include <gio/gio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define HAVE_WEBKIT_URI_SCHEME_RESPONSE WEBKIT_CHECK_VERSION(2, 36, 0)
 
 /**
  * CogDirectoryFilesHandler:
@@ -19,63 +29,1052 @@
  * also uses the URI host component. If a resolved path points to a
  * local directory and it contains a file named `index.html`, it will
  * be used as the response.
+ *
+ * When built with WebKit 2.36 or newer, requests with a `Range` header
+ * for a single byte range are answered with partial content, which
+ * allows seeking in media elements without reading whole files.
+ * Decompressed files (see [property@Cog.DirectoryFilesHandler:precompressed])
+ * are always served in full.
+ */
+
+struct _CogDirectoryFilesHandler {
+    GObject  parent;
+    GFile   *base_path;
+    gboolean use_host;
+    unsigned strip_components;
+    gboolean precompressed;
+    guint64  small_file_size;
+
+    /* Content cache, see cog_directory_files_handler_set_cache_size(). */
+    guint64     cache_size;
+    guint64     cache_used;
+    GHashTable *cache;      /* Path → CacheEntry */
+    GQueue      cache_lru;  /* Most recently used first. */
+
+    /* Resolved paths, see cog_directory_files_handler_set_resolve_ttl(). */
+    unsigned    resolve_ttl;    /* Milliseconds. */
+    GHashTable *resolved;       /* Path → ResolvedEntry */
+};
+
+enum {
+    PROP_0,
+    PROP_BASE_PATH,
+    PROP_USE_HOST,
+    PROP_STRIP_COMPONENTS,
+    PROP_CACHE_SIZE,
+    PROP_PRECOMPRESSED,
+    PROP_RESOLVE_TTL,
+    PROP_SMALL_FILE_SIZE,
+    N_PROPERTIES,
+};
+
+static GParamSpec *s_properties[N_PROPERTIES] = { NULL, };
+
+static const char s_file_query_attributes[] =
+    G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE ","
+    G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+    G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+    G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+    G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC;
+
+
+/*
+ * Files bigger than this fraction of the cache size are never cached,
+ * to avoid evicting many small entries to make room for a single one.
+ */
+#define CACHE_ENTRY_MAX_FRACTION 4
+
+typedef struct {
+    GList    link;      /* Node in the LRU queue, data points to the entry. */
+    char    *path;
+    GBytes  *contents;
+    char    *mime_type;
+    guint64  mtime;     /* Microseconds. */
+} CacheEntry;
+
+static void
+cache_entry_free (CacheEntry *entry)
+{
+    g_free (entry->path);
+    g_bytes_unref (entry->contents);
+    g_free (entry->mime_type);
+    g_free (entry);
+}
+
+static guint64
+file_info_get_mtime (GFileInfo *info)
+{
+    return g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+        g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+}
+
+static void
+cog_directory_files_handler_cache_remove (CogDirectoryFilesHandler *handler,
+                                          CacheEntry               *entry)
+{
+    g_queue_unlink (&handler->cache_lru, &entry->link);
+    handler->cache_used -= g_bytes_get_size (entry->contents);
+    g_hash_table_remove (handler->cache, entry->path);
+}
+
+static void
+cog_directory_files_handler_cache_trim (CogDirectoryFilesHandler *handler,
+                                        guint64                   size)
+{
+    while (handler->cache_lru.tail && handler->cache_used > size)
+        cog_directory_files_handler_cache_remove (handler, handler->cache_lru.tail->data);
+}
+
+/*
+ * Returns the cached contents for a path only if the file has not been
+ * modified since they were loaded, stale entries are dropped.
+ */
+static CacheEntry*
+cog_directory_files_handler_cache_lookup (CogDirectoryFilesHandler *handler,
+                                          const char               *path,
+                                          guint64                   mtime,
+                                          goffset                   size)
+{
+    if (!handler->cache)
+        return NULL;
+
+    CacheEntry *entry = g_hash_table_lookup (handler->cache, path);
+    if (!entry)
+        return NULL;
+
+    if (entry->mtime != mtime || size < 0 || g_bytes_get_size (entry->contents) != (gsize) size) {
+        cog_directory_files_handler_cache_remove (handler, entry);
+        return NULL;
+    }
+
+    g_queue_unlink (&handler->cache_lru, &entry->link);
+    g_queue_push_head_link (&handler->cache_lru, &entry->link);
+    return entry;
+}
+
+static gboolean
+cog_directory_files_handler_cache_accepts (CogDirectoryFilesHandler *handler,
+                                           goffset                   size)
+{
+    return handler->cache_size > 0 && size >= 0 &&
+        (guint64) size <= handler->cache_size / CACHE_ENTRY_MAX_FRACTION;
+}
+
+static void
+cog_directory_files_handler_cache_insert (CogDirectoryFilesHandler *handler,
+                                          const char               *path,
+                                          GBytes                   *contents,
+                                          const char               *mime_type,
+                                          guint64                   mtime)
+{
+    const gsize size = g_bytes_get_size (contents);
+
+    /* The cache size may have been changed while the file was loading. */
+    if (!cog_directory_files_handler_cache_accepts (handler, size))
+        return;
+
+    if (!handler->cache) {
+        handler->cache = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                                (GDestroyNotify) cache_entry_free);
+    }
+
+    CacheEntry *old_entry = g_hash_table_lookup (handler->cache, path);
+    if (old_entry)
+        cog_directory_files_handler_cache_remove (handler, old_entry);
+
+    cog_directory_files_handler_cache_trim (handler, handler->cache_size - size);
+
+    CacheEntry *entry = g_new0 (CacheEntry, 1);
+    entry->link.data = entry;
+    entry->path = g_strdup (path);
+    entry->contents = g_bytes_ref (contents);
+    entry->mime_type = g_strdup (mime_type);
+    entry->mtime = mtime;
+
+    g_hash_table_insert (handler->cache, entry->path, entry);
+    g_queue_push_head_link (&handler->cache_lru, &entry->link);
+    handler->cache_used += size;
+}
+
+/*
+ * Resolved paths are remembered for a limited time, to skip querying
+ * the file system again for directories (which are mapped to their
+ * index file) and for paths which do not exist. The table is emptied
+ * when it grows too much, which can only happen when many different
+ * non-existent paths are requested.
+ */
+#define RESOLVED_MAX_ENTRIES 1024
+
+typedef struct {
+    GFile  *index;      /* Index file for directories, NULL if not found. */
+    gint64  expires;    /* Monotonic time, microseconds. */
+} ResolvedEntry;
+
+static void
+resolved_entry_free (ResolvedEntry *entry)
+{
+    g_clear_object (&entry->index);
+    g_free (entry);
+}
+
+static ResolvedEntry*
+cog_directory_files_handler_resolved_lookup (CogDirectoryFilesHandler *handler,
+                                             const char               *path)
+{
+    if (!handler->resolved)
+        return NULL;
+
+    ResolvedEntry *entry = g_hash_table_lookup (handler->resolved, path);
+    if (entry && entry->expires <= g_get_monotonic_time ()) {
+        g_hash_table_remove (handler->resolved, path);
+        return NULL;
+    }
+    return entry;
+}
+
+static gboolean
+resolved_entry_is_expired (void *key,
+                           void *value,
+                           void *now)
+{
+    return ((ResolvedEntry*) value)->expires <= *((gint64*) now);
+}
+
+static void
+cog_directory_files_handler_resolved_insert (CogDirectoryFilesHandler *handler,
+                                             const char               *path,
+                                             GFile                    *index)
+{
+    if (handler->resolve_ttl == 0)
+        return;
+
+    const gint64 now = g_get_monotonic_time ();
+
+    if (!handler->resolved) {
+        handler->resolved = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                                   (GDestroyNotify) resolved_entry_free);
+    } else if (g_hash_table_size (handler->resolved) >= RESOLVED_MAX_ENTRIES) {
+        g_hash_table_foreach_remove (handler->resolved, resolved_entry_is_expired, (void*) &now);
+        if (g_hash_table_size (handler->resolved) >= RESOLVED_MAX_ENTRIES)
+            g_hash_table_remove_all (handler->resolved);
+    }
+
+    ResolvedEntry *entry = g_new0 (ResolvedEntry, 1);
+    entry->index = index ? g_object_ref (index) : NULL;
+    entry->expires = now + (gint64) handler->resolve_ttl * 1000;
+    g_hash_table_replace (handler->resolved, g_strdup (path), entry);
+}
+
+
+/*
+ * Checks whether a file is base_path or contained inside it, to prevent
+ * URIs with ".." components from accessing resources outside of base_path.
+ * The g_file_get_relative_path() method returns NULL when the file path is
+ * NOT descendant of base_path, or when both paths are the same.
+ */
+static gboolean
+file_is_contained (GFile *base_path,
+                   GFile *file)
+{
+    if (g_file_equal (base_path, file))
+        return TRUE;
+
+    g_autofree char *relative_path = g_file_get_relative_path (base_path, file);
+    return relative_path != NULL;
+}
+
+
+/*
+ * State kept while a request is being handled, passed along through the
+ * asynchronous operations needed to resolve and load a file.
+ */
+typedef struct {
+    CogDirectoryFilesHandler *handler;
+    WebKitURISchemeRequest   *request;
+    GFile                    *base_path;  /* Root of the served tree. */
+    GFile                    *file;  /* Uncompressed file, or file being read in a thread. */
+    GFileInfo                *info;
+    gboolean                  resolving_index;
+} RequestData;
+
+static RequestData*
+request_data_new (CogDirectoryFilesHandler *handler,
+                  WebKitURISchemeRequest   *request,
+                  GFile                    *base_path)
+{
+    RequestData *data = g_new0 (RequestData, 1);
+    data->handler = g_object_ref (handler);
+    data->request = g_object_ref (request);
+    data->base_path = g_object_ref (base_path);
+    return data;
+}
+
+static void
+request_data_free (RequestData *data)
+{
+    g_clear_object (&data->handler);
+    g_clear_object (&data->request);
+    g_clear_object (&data->base_path);
+    g_clear_object (&data->file);
+    g_clear_object (&data->info);
+    g_free (data);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (RequestData, request_data_free)
+
+
+#if HAVE_WEBKIT_URI_SCHEME_RESPONSE
+
+/*
+ * Input stream which returns at most a given number of bytes from its base
+ * stream, used to answer range requests with a stream that stops at the
+ * end of the requested range.
+ */
+#define COG_TYPE_BOUNDED_INPUT_STREAM (cog_bounded_input_stream_get_type ())
+G_DECLARE_FINAL_TYPE (CogBoundedInputStream, cog_bounded_input_stream, COG, BOUNDED_INPUT_STREAM, GFilterInputStream)
+
+struct _CogBoundedInputStream {
+    GFilterInputStream parent;
+    guint64            remaining;
+};
+
+G_DEFINE_TYPE (CogBoundedInputStream, cog_bounded_input_stream, G_TYPE_FILTER_INPUT_STREAM)
+
+static gssize
+cog_bounded_input_stream_read (GInputStream *stream,
+                               void         *buffer,
+                               gsize         count,
+                               GCancellable *cancellable,
+                               GError      **error)
+{
+    CogBoundedInputStream *self = COG_BOUNDED_INPUT_STREAM (stream);
+
+    count = MIN (count, self->remaining);
+    if (count == 0)
+        return 0;
+
+    gssize n_read = g_input_stream_read (g_filter_input_stream_get_base_stream (G_FILTER_INPUT_STREAM (stream)),
+                                         buffer, count, cancellable, error);
+    if (n_read > 0)
+        self->remaining -= n_read;
+    return n_read;
+}
+
+static gssize
+cog_bounded_input_stream_skip (GInputStream *stream,
+                               gsize         count,
+                               GCancellable *cancellable,
+                               GError      **error)
+{
+    CogBoundedInputStream *self = COG_BOUNDED_INPUT_STREAM (stream);
+
+    count = MIN (count, self->remaining);
+    if (count == 0)
+        return 0;
+
+    gssize n_skipped = g_input_stream_skip (g_filter_input_stream_get_base_stream (G_FILTER_INPUT_STREAM (stream)),
+                                            count, cancellable, error);
+    if (n_skipped > 0)
+        self->remaining -= n_skipped;
+    return n_skipped;
+}
+
+static void
+cog_bounded_input_stream_class_init (CogBoundedInputStreamClass *klass)
+{
+    GInputStreamClass *stream_class = G_INPUT_STREAM_CLASS (klass);
+    stream_class->read_fn = cog_bounded_input_stream_read;
+    stream_class->skip = cog_bounded_input_stream_skip;
+}
+
+static void
+cog_bounded_input_stream_init (CogBoundedInputStream *self)
+{
+}
+
+static GInputStream*
+cog_bounded_input_stream_new (GInputStream *base_stream,
+                              guint64       length)
+{
+    CogBoundedInputStream *self = g_object_new (COG_TYPE_BOUNDED_INPUT_STREAM,
+                                                "base-stream", base_stream,
+                                                NULL);
+    self->remaining = length;
+    return G_INPUT_STREAM (self);
+}
+
+
+typedef enum {
+    RANGE_NONE,
+    RANGE_SATISFIABLE,
+    RANGE_NOT_SATISFIABLE,
+} RangeResult;
+
+/*
+ * Parses the Range header of the request for a resource of the given
+ * size. Only single byte ranges are supported, requests for multiple
+ * ranges or with a Range header which cannot be parsed are answered
+ * with the whole resource, as allowed by RFC 9110. On success the
+ * range start offset and its length are stored.
+ */
+static RangeResult
+request_data_get_range (RequestData *data,
+                        goffset      size,
+                        goffset     *start,
+                        goffset     *length)
+{
+    SoupMessageHeaders *headers = webkit_uri_scheme_request_get_http_headers (data->request);
+    if (!headers)
+        return RANGE_NONE;
+
+    /* There are no validators to check If-Range against. */
+    const char *value = soup_message_headers_get_one (headers, "Range");
+    if (!value || soup_message_headers_get_one (headers, "If-Range"))
+        return RANGE_NONE;
+
+    if (!g_str_has_prefix (value, "bytes="))
+        return RANGE_NONE;
+    value += strlen ("bytes=");
+
+    if (strchr (value, ','))
+        return RANGE_NONE;
+
+    char *end;
+    guint64 first = 0, last = G_MAXUINT64;
+    gboolean has_first = g_ascii_isdigit (*value);
+    if (has_first) {
+        first = g_ascii_strtoull (value, &end, 10);
+        value = end;
+    }
+    if (*value++ != '-')
+        return RANGE_NONE;
+    if (g_ascii_isdigit (*value)) {
+        last = g_ascii_strtoull (value, &end, 10);
+        value = end;
+    } else if (!has_first) {
+        return RANGE_NONE;
+    }
+    if (*value != '\0' || (has_first && first > last))
+        return RANGE_NONE;
+
+    if (!has_first) {
+        /* Suffix range: last N bytes of the resource. */
+        if (last == 0 || size == 0)
+            return RANGE_NOT_SATISFIABLE;
+        first = (last >= (guint64) size) ? 0 : size - last;
+        last = size - 1;
+    } else if (first >= (guint64) size) {
+        return RANGE_NOT_SATISFIABLE;
+    }
+
+    *start = first;
+    *length = MIN (last, (guint64) size - 1) - first + 1;
+    return RANGE_SATISFIABLE;
+}
+
+static void
+request_data_finish_with_range (RequestData  *data,
+                                GInputStream *stream,
+                                RangeResult   range,
+                                goffset       start,
+                                goffset       length,
+                                goffset       size,
+                                const char   *mime_type)
+{
+    g_autoptr(WebKitURISchemeResponse) response = NULL;
+    SoupMessageHeaders *headers = soup_message_headers_new (SOUP_MESSAGE_HEADERS_RESPONSE);
+    soup_message_headers_replace (headers, "Accept-Ranges", "bytes");
+
+    if (range == RANGE_SATISFIABLE) {
+        response = webkit_uri_scheme_response_new (stream, length);
+        webkit_uri_scheme_response_set_status (response, SOUP_STATUS_PARTIAL_CONTENT, NULL);
+        soup_message_headers_set_content_range (headers, start, start + length - 1, size);
+    } else {
+        g_autoptr(GInputStream) empty_stream = g_memory_input_stream_new ();
+        g_autofree char *content_range = g_strdup_printf ("bytes */%" G_GOFFSET_FORMAT, size);
+        response = webkit_uri_scheme_response_new (empty_stream, 0);
+        webkit_uri_scheme_response_set_status (response, SOUP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE, NULL);
+        soup_message_headers_replace (headers, "Content-Range", content_range);
+    }
+
+    webkit_uri_scheme_response_set_content_type (response, mime_type);
+    webkit_uri_scheme_response_set_http_headers (response, headers);
+    webkit_uri_scheme_request_finish_with_response (data->request, response);
+}
+
+#endif /* HAVE_WEBKIT_URI_SCHEME_RESPONSE */
+
+
+static void
+request_data_finish_with_bytes (RequestData *data,
+                                GBytes      *contents,
+                                const char  *mime_type)
+{
+#if HAVE_WEBKIT_URI_SCHEME_RESPONSE
+    const gsize size = g_bytes_get_size (contents);
+    goffset start = 0, length = 0;
+    RangeResult range = request_data_get_range (data, size, &start, &length);
+    if (range != RANGE_NONE) {
+        g_autoptr(GBytes) slice = range == RANGE_SATISFIABLE
+            ? g_bytes_new_from_bytes (contents, start, length)
+            : NULL;
+        g_autoptr(GInputStream) stream = slice ? g_memory_input_stream_new_from_bytes (slice) : NULL;
+        request_data_finish_with_range (data, stream, range, start, length, size, mime_type);
+        return;
+    }
+#endif /* HAVE_WEBKIT_URI_SCHEME_RESPONSE */
+
+    g_autoptr(GInputStream) stream = g_memory_input_stream_new_from_bytes (contents);
+    webkit_uri_scheme_request_finish (data->request,
+                                      stream,
+                                      g_bytes_get_size (contents),
+                                      mime_type);
+}
+
+
+static void
+on_file_load_contents_async_completed (GObject      *source_object,
+                                       GAsyncResult *result,
+                                       void         *user_data)
+{
+    GFile *file = G_FILE (source_object);
+    g_autoptr(RequestData) data = user_data;
+
+    g_autoptr(GError) error = NULL;
+    char *contents = NULL;
+    gsize length = 0;
+
+    if (!g_file_load_contents_finish (file, result, &contents, &length, NULL, &error)) {
+        g_assert (error);
+        webkit_uri_scheme_request_finish_error (data->request, error);
+        return;
+    }
+
+    g_autoptr(GBytes) bytes = g_bytes_new_take (contents, length);
+    const char *mime_type =
+        g_file_info_get_attribute_string (data->info, G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE);
+
+    cog_directory_files_handler_cache_insert (data->handler,
+                                              g_file_peek_path (file),
+                                              bytes,
+                                              mime_type,
+                                              file_info_get_mtime (data->info));
+    request_data_finish_with_bytes (data, bytes, mime_type);
+}
+
+
+static void
+on_file_read_async_completed (GObject      *source_object,
+                              GAsyncResult *result,
+                              void         *user_data)
+{
+    GFile *file = G_FILE (source_object);
+    g_autoptr(RequestData) data = user_data;
+
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GFileInputStream) file_stream =
+        g_file_read_finish (file, result, &error);
+
+    if (file_stream) {
+        guint64 size =
+            g_file_info_get_attribute_uint64 (data->info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
+        const char *mime_type =
+            g_file_info_get_attribute_string (data->info, G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE);
+
+#if HAVE_WEBKIT_URI_SCHEME_RESPONSE
+        goffset start = 0, length = 0;
+        RangeResult range = request_data_get_range (data, size, &start, &length);
+        if (range == RANGE_SATISFIABLE) {
+            /*
+             * Seeking a local file stream only updates the file offset,
+             * which is cheap enough to do from the main loop.
+             */
+            if (!g_seekable_seek (G_SEEKABLE (file_stream), start, G_SEEK_SET, NULL, &error)) {
+                webkit_uri_scheme_request_finish_error (data->request, error);
+                return;
+            }
+            g_autoptr(GInputStream) range_stream =
+                cog_bounded_input_stream_new (G_INPUT_STREAM (file_stream), length);
+            g_autoptr(GInputStream) stream = g_buffered_input_stream_new (range_stream);
+            request_data_finish_with_range (data, stream, range, start, length, size, mime_type);
+            return;
+        }
+        if (range == RANGE_NOT_SATISFIABLE) {
+            request_data_finish_with_range (data, NULL, range, 0, 0, size, mime_type);
+            return;
+        }
+#endif /* HAVE_WEBKIT_URI_SCHEME_RESPONSE */
+
+        g_autoptr(GInputStream) stream =
+            g_buffered_input_stream_new (G_INPUT_STREAM (file_stream));
+        webkit_uri_scheme_request_finish (data->request, stream, size, mime_type);
+    } else {
+        /*
+         * TODO: Generate a nicer error page.
+         */
+        g_assert (error);
+        webkit_uri_scheme_request_finish_error (data->request, error);
+    }
+}
+
+
+static void on_file_query_info_async_completed (GObject      *source_object,
+                                                GAsyncResult *result,
+                                                void         *user_data);
+
+static void request_data_query_file (RequestData *data,
+                                     GFile       *file);
+
+
+/*
+ * Continues handling a request for a file which is not a regular file,
+ * taking ownership of the request data. Directories are resolved to
+ * their "index.html" file.
+ */
+static void
+request_data_resolve_non_regular (RequestData *data,
+                                  GFile       *file,
+                                  GFileType    type)
+{
+    g_autoptr(RequestData) data_ptr = data;
+    g_autoptr(GError) error = NULL;
+
+    if (type == G_FILE_TYPE_DIRECTORY) {
+        /*
+         * If the request has been marked, it means this function is being
+         * called after having previously found a directory. In that case,
+         * do not try to resolve "index.html" a second time and produce
+         * an error instead.
+         */
+        if (data->resolving_index) {
+            g_autofree char *path = g_file_get_path (file);
+            error = g_error_new (cog_directory_files_handler_error_quark (),
+                                 COG_DIRECTORY_FILES_HANDLER_ERROR_CANNOT_RESOLVE,
+                                 "Path '%s' does not represent a regular file",
+                                 path);
+            webkit_uri_scheme_request_finish_error (data->request, error);
+        } else {
+            /* Mark request as being resolved for its index. */
+            data->resolving_index = TRUE;
+            g_autoptr(GFile) index = g_file_get_child (file, "index.html");
+            cog_directory_files_handler_resolved_insert (data->handler, g_file_peek_path (file), index);
+            request_data_query_file (g_steal_pointer (&data_ptr), index);
+        }
+    } else {
+        g_autofree char *path = g_file_get_path (file);
+        error = g_error_new (cog_directory_files_handler_error_quark (),
+                             COG_DIRECTORY_FILES_HANDLER_ERROR_CANNOT_RESOLVE,
+                             "Path '%s' does not represent a regular file or directory",
+                             path);
+        webkit_uri_scheme_request_finish_error (data->request, error);
+    }
+}
+
+
+/*
+ * Fast path for small files: opening, checking and reading a file is done
+ * with blocking calls in a single job, run by a small pool of threads
+ * shared by all handlers. This needs a single main loop iteration to get
+ * the result, instead of one for each of the chained asynchronous GIO
+ * operations. Files bigger than the "small-file-size" threshold are
+ * detected after opening them, and handled as usual.
+ */
+#define SMALL_FILE_MAX_THREADS 4
+
+typedef struct {
+    char    *path;
+    guint64  max_size;
+    GBytes  *cached;        /* Contents from the cache, may be NULL. */
+    char    *cached_mime_type;
+    guint64  cached_mtime;
+} SmallFileJob;
+
+typedef struct {
+    GFileType type;
+    GBytes   *contents;     /* NULL if the file is too big. */
+    char     *mime_type;
+    guint64   mtime;
+    gboolean  from_cache;
+} SmallFileResult;
+
+static void
+small_file_job_free (SmallFileJob *job)
+{
+    g_free (job->path);
+    g_clear_pointer (&job->cached, g_bytes_unref);
+    g_free (job->cached_mime_type);
+    g_free (job);
+}
+
+static void
+small_file_result_free (SmallFileResult *result)
+{
+    g_clear_pointer (&result->contents, g_bytes_unref);
+    g_free (result->mime_type);
+    g_free (result);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (SmallFileResult, small_file_result_free)
+
+static GBytes*
+read_fd_contents (int      fd,
+                  gsize    size,
+                  GError **error)
+{
+    g_autofree char *buffer = g_malloc (size);
+    gsize n_total = 0;
+
+    while (n_total < size) {
+        gssize n_read = read (fd, buffer + n_total, size - n_total);
+        if (n_read < 0) {
+            if (errno == EINTR)
+                continue;
+            int saved_errno = errno;
+            g_set_error_literal (error, G_IO_ERROR, g_io_error_from_errno (saved_errno), g_strerror (saved_errno));
+            return NULL;
+        }
+        if (n_read == 0)
+            break;  /* The file was truncated after fstat(). */
+        n_total += n_read;
+    }
+
+    return g_bytes_new_take (g_steal_pointer (&buffer), n_total);
+}
+
+static void
+small_file_job_run (void *task_ptr,
+                    void *user_data G_GNUC_UNUSED)
+{
+    g_autoptr(GTask) task = task_ptr;
+    SmallFileJob *job = g_task_get_task_data (task);
+
+    /* Non-blocking avoids hanging on FIFOs, no effect on regular files. */
+    int fd = open (job->path, O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+    if (fd < 0) {
+        int saved_errno = errno;
+        g_task_return_new_error (task, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                                 "Cannot open '%s': %s", job->path, g_strerror (saved_errno));
+        return;
+    }
+
+    g_autoptr(SmallFileResult) result = g_new0 (SmallFileResult, 1);
+    g_autoptr(GError) error = NULL;
+    struct stat st;
+
+    if (fstat (fd, &st) != 0) {
+        int saved_errno = errno;
+        g_set_error (&error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                     "Cannot stat '%s': %s", job->path, g_strerror (saved_errno));
+    } else if (S_ISREG (st.st_mode)) {
+        result->type = G_FILE_TYPE_REGULAR;
+        result->mtime = (guint64) st.st_mtim.tv_sec * G_USEC_PER_SEC + st.st_mtim.tv_nsec / 1000;
+
+        if (job->cached && job->cached_mtime == result->mtime &&
+            g_bytes_get_size (job->cached) == (gsize) st.st_size) {
+            result->contents = g_bytes_ref (job->cached);
+            result->mime_type = g_strdup (job->cached_mime_type);
+            result->from_cache = TRUE;
+        } else if ((guint64) st.st_size <= job->max_size) {
+            result->contents = read_fd_contents (fd, st.st_size, &error);
+            if (result->contents) {
+                gsize length;
+                const void *contents = g_bytes_get_data (result->contents, &length);
+                result->mime_type = g_content_type_guess (job->path, contents, length, NULL);
+            }
+        }
+    } else if (S_ISDIR (st.st_mode)) {
+        result->type = G_FILE_TYPE_DIRECTORY;
+    } else {
+        result->type = G_FILE_TYPE_SPECIAL;
+    }
+
+    close (fd);
+
+    if (error)
+        g_task_return_error (task, g_steal_pointer (&error));
+    else
+        g_task_return_pointer (task, g_steal_pointer (&result), (GDestroyNotify) small_file_result_free);
+}
+
+static void
+on_small_file_job_completed (GObject      *source_object,
+                             GAsyncResult *result,
+                             void         *user_data)
+{
+    g_autoptr(RequestData) data = user_data;
+    GFile *file = data->file;
+
+    g_autoptr(GError) error = NULL;
+    g_autoptr(SmallFileResult) file_result = g_task_propagate_pointer (G_TASK (result), &error);
+
+    if (!file_result) {
+        g_assert (error);
+        if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+            cog_directory_files_handler_resolved_insert (data->handler, g_file_peek_path (file), NULL);
+        webkit_uri_scheme_request_finish_error (data->request, error);
+        return;
+    }
+
+    if (file_result->type != G_FILE_TYPE_REGULAR) {
+        g_autoptr(GFile) non_regular_file = g_object_ref (file);
+        request_data_resolve_non_regular (g_steal_pointer (&data), non_regular_file, file_result->type);
+        return;
+    }
+
+    if (!file_result->contents) {
+        /* Too big, go through the usual path. */
+        g_file_query_info_async (file,
+                                 s_file_query_attributes,
+                                 G_FILE_QUERY_INFO_NONE,
+                                 G_PRIORITY_DEFAULT,
+                                 NULL,
+                                 on_file_query_info_async_completed,
+                                 g_steal_pointer (&data));
+        return;
+    }
+
+    const gsize size = g_bytes_get_size (file_result->contents);
+    if (file_result->from_cache) {
+        /* Marks the entry as recently used. */
+        cog_directory_files_handler_cache_lookup (data->handler, g_file_peek_path (file), file_result->mtime, size);
+    } else {
+        cog_directory_files_handler_cache_insert (data->handler,
+                                                  g_file_peek_path (file),
+                                                  file_result->contents,
+                                                  file_result->mime_type,
+                                                  file_result->mtime);
+    }
+    request_data_finish_with_bytes (data, file_result->contents, file_result->mime_type);
+}
+
+static void
+request_data_read_small_file (RequestData *data,
+                              GFile       *file)
+{
+    static GThreadPool *s_small_file_pool = NULL;
+    if (g_once_init_enter (&s_small_file_pool)) {
+        GThreadPool *pool = g_thread_pool_new (small_file_job_run, NULL, SMALL_FILE_MAX_THREADS, FALSE, NULL);
+        g_once_init_leave (&s_small_file_pool, pool);
+    }
+
+    SmallFileJob *job = g_new0 (SmallFileJob, 1);
+    job->path = g_file_get_path (file);
+    job->max_size = data->handler->small_file_size;
+
+    /* Cache entries are validated by the job, which needs a snapshot. */
+    CacheEntry *entry = data->handler->cache ? g_hash_table_lookup (data->handler->cache, job->path) : NULL;
+    if (entry) {
+        job->cached = g_bytes_ref (entry->contents);
+        job->cached_mime_type = g_strdup (entry->mime_type);
+        job->cached_mtime = entry->mtime;
+    }
+
+    g_set_object (&data->file, file);
+
+    GTask *task = g_task_new (NULL, NULL, on_small_file_job_completed, data);
+    g_task_set_source_tag (task, request_data_read_small_file);
+    g_task_set_task_data (task, job, (GDestroyNotify) small_file_job_free);
+    g_thread_pool_push (s_small_file_pool, task, NULL);
+}
+
+
+static void
+on_compressed_file_read_async_completed (GObject      *source_object,
+                                         GAsyncResult *result,
+                                         void         *user_data)
+{
+    GFile *file = G_FILE (source_object);
+    g_autoptr(RequestData) data = user_data;
+
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GFileInputStream) file_stream =
+        g_file_read_finish (file, result, &error);
+
+    if (!file_stream) {
+        g_assert (error);
+        webkit_uri_scheme_request_finish_error (data->request, error);
+        return;
+    }
+
+    /*
+     * The MIME type is guessed from the name of the uncompressed file.
+     * Its size is unknown until the whole stream has been decompressed.
+     */
+    g_autofree char *basename = g_file_get_basename (data->file);
+    g_autofree char *mime_type = g_content_type_guess (basename, NULL, 0, NULL);
+
+    g_autoptr(GZlibDecompressor) decompressor = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP);
+    g_autoptr(GInputStream) stream =
+        g_converter_input_stream_new (G_INPUT_STREAM (file_stream), G_CONVERTER (decompressor));
+    webkit_uri_scheme_request_finish (data->request, stream, -1, mime_type);
+}
+
+
+static void request_data_load_regular (RequestData *data,
+                                      GFile       *file,
+                                      GFileInfo   *info);
+
+static void
+on_compressed_file_query_info_async_completed (GObject      *source_object,
+                                               GAsyncResult *result,
+                                               void         *user_data)
+{
+    GFile *compressed_file = G_FILE (source_object);
+    g_autoptr(RequestData) data = user_data;
+
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GFileInfo) compressed_info = g_file_query_info_finish (compressed_file, result, &error);
+    if (compressed_info && g_file_info_get_file_type (compressed_info) == G_FILE_TYPE_REGULAR) {
+        g_file_read_async (compressed_file,
+                           G_PRIORITY_DEFAULT,
+                           NULL,
+                           on_compressed_file_read_async_completed,
+                           g_steal_pointer (&data));
+        return;
+    }
+
+    /* Remember missing siblings, most files do not have one. */
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+        cog_directory_files_handler_resolved_insert (data->handler, g_file_peek_path (compressed_file), NULL);
+
+    /* No usable compressed sibling, fall back to the uncompressed file. */
+    g_autoptr(GFile) file = g_object_ref (data->file);
+    if (!data->info) {
+        cog_directory_files_handler_resolved_insert (data->handler, g_file_peek_path (file), NULL);
+        g_clear_error (&error);
+        error = g_error_new (G_IO_ERROR,
+                             G_IO_ERROR_NOT_FOUND,
+                             "Path '%s' does not exist",
+                             g_file_peek_path (file));
+        webkit_uri_scheme_request_finish_error (data->request, error);
+        return;
+    }
+
+    g_autoptr(GFileInfo) info = g_steal_pointer (&data->info);
+    request_data_load_regular (g_steal_pointer (&data), file, info);
+}
+
+
+/*
+ * Starts looking up the gzip-compressed sibling of a file which is known
+ * not to be a directory, taking ownership of the request data. The info
+ * of the uncompressed file is NULL if it does not exist. Returns FALSE
+ * without doing anything if there is no sibling to look up: the option is
+ * disabled, the file is the root of the served tree (whose sibling would
+ * be outside of it), or the sibling is remembered as non-existent.
  */
+static gboolean
+request_data_query_compressed (RequestData *data,
+                               GFile       *file,
+                               GFileInfo   *info)
+{
+    if (!data->handler->precompressed || g_file_equal (data->base_path, file))
+        return FALSE;
 
-struct _CogDirectoryFilesHandler {
-    GObject  parent;
-    GFile   *base_path;
-    gboolean use_host;
-    unsigned strip_components;
-};
+    g_autofree char *compressed_path = g_strconcat (g_file_peek_path (file), ".gz", NULL);
+    if (cog_directory_files_handler_resolved_lookup (data->handler, compressed_path))
+        return FALSE;
 
-enum {
-    PROP_0,
-    PROP_BASE_PATH,
-    PROP_USE_HOST,
-    PROP_STRIP_COMPONENTS,
-    N_PROPERTIES,
-};
+    g_autoptr(GFile) compressed_file = g_file_new_for_path (compressed_path);
+    if (!file_is_contained (data->base_path, compressed_file))
+        return FALSE;
 
-static GParamSpec *s_properties[N_PROPERTIES] = { NULL, };
+    g_set_object (&data->file, file);
+    g_set_object (&data->info, info);
+    g_file_query_info_async (compressed_file,
+                             G_FILE_ATTRIBUTE_STANDARD_TYPE,
+                             G_FILE_QUERY_INFO_NONE,
+                             G_PRIORITY_DEFAULT,
+                             NULL,
+                             on_compressed_file_query_info_async_completed,
+                             data);
+    return TRUE;
+}
 
-static const char s_file_query_attributes[] =
-    G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE ","
-    G_FILE_ATTRIBUTE_STANDARD_SIZE ","
-    G_FILE_ATTRIBUTE_STANDARD_TYPE;
 
-static void* s_request_resolving_index = (void*) 0xCAFECAFE;
+/*
+ * Starts resolving a file, unless the result of a previous resolution is
+ * still remembered. When enabled, a gzip-compressed sibling with the same
+ * name plus a ".gz" suffix is looked up once the file is known not to be
+ * a directory, and used instead of the original file if it exists. Brotli
+ * and Zstandard are not supported because GIO does not provide
+ * decompressors for them.
+ */
+static void
+request_data_query_file (RequestData *data,
+                         GFile       *file)
+{
+    ResolvedEntry *resolved =
+        cog_directory_files_handler_resolved_lookup (data->handler, g_file_peek_path (file));
+    if (resolved) {
+        if (!resolved->index) {
+            g_autoptr(GError) error = g_error_new (G_IO_ERROR,
+                                                   G_IO_ERROR_NOT_FOUND,
+                                                   "Path '%s' does not exist",
+                                                   g_file_peek_path (file));
+            webkit_uri_scheme_request_finish_error (data->request, error);
+            request_data_free (data);
+            return;
+        }
+
+        /* Known directory, go straight to its (maybe also known) index. */
+        data->resolving_index = TRUE;
+        g_autoptr(GFile) index = g_object_ref (resolved->index);
+        request_data_query_file (data, index);
+        return;
+    }
 
-G_DEFINE_QUARK (cog-directory-files-handler-data, cog_directory_files_handler);
+    if (data->handler->small_file_size > 0 && !data->handler->precompressed) {
+        request_data_read_small_file (data, file);
+    } else {
+        g_file_query_info_async (file,
+                                 s_file_query_attributes,
+                                 G_FILE_QUERY_INFO_NONE,
+                                 G_PRIORITY_DEFAULT,
+                                 NULL,
+                                 on_file_query_info_async_completed,
+                                 data);
+    }
+}
 
 
+/*
+ * Continues handling a request for a regular file, taking ownership
+ * of the request data.
+ */
 static void
-on_file_read_async_completed (GObject      *source_object,
-                              GAsyncResult *result,
-                              void         *user_data)
+request_data_load_regular (RequestData *data,
+                           GFile       *file,
+                           GFileInfo   *info)
 {
-    g_autoptr(GFile) file = G_FILE (g_object_ref (source_object));
-    g_autoptr(WebKitURISchemeRequest) request = WEBKIT_URI_SCHEME_REQUEST (user_data);
+    g_autoptr(RequestData) data_ptr = data;
+
+    CacheEntry *entry = cog_directory_files_handler_cache_lookup (data->handler,
+                                                                  g_file_peek_path (file),
+                                                                  file_info_get_mtime (info),
+                                                                  g_file_info_get_size (info));
+    if (entry) {
+        request_data_finish_with_bytes (data, entry->contents, entry->mime_type);
+        return;
+    }
 
-    g_autoptr(GError) error = NULL;
-    g_autoptr(GFileInputStream) file_stream =
-        g_file_read_finish (file, result, &error);
+    /*
+     * The current file information will be retrieved by the completion
+     * callbacks to avoid querying again.
+     */
+    g_set_object (&data->info, info);
 
-    if (file_stream) {
-        g_autoptr(GInputStream) stream =
-            g_buffered_input_stream_new (G_INPUT_STREAM (file_stream));
-        g_autoptr(GFileInfo) info =
-            G_FILE_INFO (g_object_steal_qdata (source_object, cog_directory_files_handler_quark ()));
-        guint64 size =
-            g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
-        const char *mime_type =
-            g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE);
-        webkit_uri_scheme_request_finish (request, stream, size, mime_type);
+    if (cog_directory_files_handler_cache_accepts (data->handler, g_file_info_get_size (info))) {
+        g_file_load_contents_async (file,
+                                    NULL,
+                                    on_file_load_contents_async_completed,
+                                    g_steal_pointer (&data_ptr));
     } else {
-        /*
-         * TODO: Generate a nicer error page.
-         */
-        g_assert (error);
-        webkit_uri_scheme_request_finish_error (request, error);
+        g_file_read_async (file,
+                           G_PRIORITY_DEFAULT,
+                           NULL,
+                           on_file_read_async_completed,
+                           g_steal_pointer (&data_ptr));
     }
 }
 
@@ -85,15 +1084,23 @@ on_file_query_info_async_completed (GObject      *source_object,
                                     GAsyncResult *result,
                                     void         *user_data)
 {
-    g_autoptr(GFile) file = G_FILE (g_object_ref (source_object));
-    g_autoptr(WebKitURISchemeRequest) request = WEBKIT_URI_SCHEME_REQUEST (user_data);
+    GFile *file = G_FILE (source_object);
+    g_autoptr(RequestData) data = user_data;
 
     g_autoptr(GError) error = NULL;
     g_autoptr(GFileInfo) info = g_file_query_info_finish (file, result, &error);
 
     if (!info) {
         g_assert (error);
-        webkit_uri_scheme_request_finish_error (request, error);
+        if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND)) {
+            /* Only the compressed version may be present. */
+            if (request_data_query_compressed (data, file, NULL)) {
+                g_steal_pointer (&data);
+                return;
+            }
+            cog_directory_files_handler_resolved_insert (data->handler, g_file_peek_path (file), NULL);
+        }
+        webkit_uri_scheme_request_finish_error (data->request, error);
         return;
     }
 
@@ -101,56 +1108,13 @@ on_file_query_info_async_completed (GObject      *source_object,
         g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_STANDARD_TYPE);
 
     if (type == G_FILE_TYPE_REGULAR) {
-        /*
-         * The current file information will be retrieved by 
-         * on_file_read_async_completed() to avoid querying again.
-         */
-        g_object_set_qdata_full (source_object,
-                                 cog_directory_files_handler_quark (),
-                                 g_steal_pointer (&info),
-                                 g_object_unref);
-        g_file_read_async (file,
-                           G_PRIORITY_DEFAULT,
-                           NULL,
-                           on_file_read_async_completed,
-                           g_steal_pointer (&request));
-    } else if (type == G_FILE_TYPE_DIRECTORY) {
-        /*
-         * If the request has been marked, it means this function is being
-         * called after having previously found a directory. In that case,
-         * do not try to resolve "index.html" a second time and produce
-         * an error instead.
-         */
-        if (s_request_resolving_index == g_object_get_qdata (G_OBJECT (request),
-                                                             cog_directory_files_handler_quark ()))
-        {
-            g_autofree char *path = g_file_get_path (file);
-            error = g_error_new (cog_directory_files_handler_error_quark (),
-                                 COG_DIRECTORY_FILES_HANDLER_ERROR_CANNOT_RESOLVE,
-                                 "Path '%s' does not represent a regular file",
-                                 path);
-            webkit_uri_scheme_request_finish_error (request, error);
-        } else {
-            /* Mark request as being resolved for its index. */
-            g_object_set_qdata (G_OBJECT (request),
-                                cog_directory_files_handler_quark (),
-                                s_request_resolving_index);
-            g_autoptr(GFile) index = g_file_get_child (file, "index.html");
-            g_file_query_info_async (index,
-                                     s_file_query_attributes,
-                                     G_FILE_QUERY_INFO_NONE,
-                                     G_PRIORITY_DEFAULT,
-                                     NULL,
-                                     on_file_query_info_async_completed,
-                                     g_steal_pointer (&request));
+        if (request_data_query_compressed (data, file, info)) {
+            g_steal_pointer (&data);
+            return;
         }
+        request_data_load_regular (g_steal_pointer (&data), file, info);
     } else {
-        g_autofree char *path = g_file_get_path (file);
-        error = g_error_new (cog_directory_files_handler_error_quark (),
-                             COG_DIRECTORY_FILES_HANDLER_ERROR_CANNOT_RESOLVE,
-                             "Path '%s' does not represent a regular file or directory",
-                             path);
-        webkit_uri_scheme_request_finish_error (request, error);
+        request_data_resolve_non_regular (g_steal_pointer (&data), file, type);
     }
 }
 
@@ -161,11 +1125,13 @@ cog_directory_files_handler_run (CogRequestHandler      *request_handler,
 {
     CogDirectoryFilesHandler *handler = COG_DIRECTORY_FILES_HANDLER(request_handler);
 
-#if COG_USE_SOUP2
-    g_autoptr(SoupURI) uri = soup_uri_new(webkit_uri_scheme_request_get_uri(request));
-#else
-    g_autoptr(GUri) uri = g_uri_parse(webkit_uri_scheme_request_get_uri(request), SOUP_HTTP_URI_FLAGS, NULL);
-#endif
+    CogRequestUri *uri = cog_request_handler_get_request_uri (request);
+    if (!uri) {
+        g_autoptr(GError) error = g_error_new (G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT, "Invalid URI: %s",
+                                               webkit_uri_scheme_request_get_uri (request));
+        webkit_uri_scheme_request_finish_error (request, error);
+        return;
+    }
 
     /*
      * If we get an empty path, redirect to the root resource "/", otherwise
@@ -178,8 +1144,9 @@ cog_directory_files_handler_run (CogRequestHandler      *request_handler,
 #endif
     if (path[0] != '/') {
 #if COG_USE_SOUP2
-        soup_uri_set_path(uri, "/");
-        g_autofree char *uri_string = soup_uri_to_string(uri, FALSE);
+        g_autoptr(SoupURI) new_uri = soup_uri_copy(uri);
+        soup_uri_set_path(new_uri, "/");
+        g_autofree char *uri_string = soup_uri_to_string(new_uri, FALSE);
 #else
         g_autoptr(GUri) new_uri = soup_uri_copy(uri, SOUP_URI_PATH, "/", SOUP_URI_NONE);
         g_autofree char *uri_string = g_uri_to_string(new_uri);
@@ -240,33 +1207,17 @@ cog_directory_files_handler_run (CogRequestHandler      *request_handler,
 
     g_autoptr(GFile) file = g_file_get_child (base_path, path);
 
-    /*
-     * Check whether the resolved path is contained inside base_path,
-     * to prevent URIs with ".." components from accessing resources
-     * outside of base_path. The g_file_get_relative_path() method
-     * returns NULL when the file path is NOT descendant of base_path,
-     * or when both paths are the same.
-     */
-    if (!g_file_equal (base_path, file)) {
-        g_autofree char *relative_path = g_file_get_relative_path (base_path, file);
-        if (!relative_path) {
-            g_autoptr(GError) error = g_error_new (G_FILE_ERROR,
-                                                   G_FILE_ERROR_PERM,
-                                                   "Resolved path '%s' not "
-                                                   "contained in base path '%s'",
-                                                   g_file_peek_path (file),
-                                                   g_file_peek_path (base_path));
-            return webkit_uri_scheme_request_finish_error (request, error);
-        }
+    if (!file_is_contained (base_path, file)) {
+        g_autoptr(GError) error = g_error_new (G_FILE_ERROR,
+                                               G_FILE_ERROR_PERM,
+                                               "Resolved path '%s' not "
+                                               "contained in base path '%s'",
+                                               g_file_peek_path (file),
+                                               g_file_peek_path (base_path));
+        return webkit_uri_scheme_request_finish_error (request, error);
     }
 
-    g_file_query_info_async (file,
-                             s_file_query_attributes,
-                             G_FILE_QUERY_INFO_NONE,
-                             G_PRIORITY_DEFAULT,
-                             NULL,
-                             on_file_query_info_async_completed,
-                             g_object_ref (request));
+    request_data_query_file (request_data_new (handler, request, base_path), file);
 }
 
 static void
@@ -300,6 +1251,18 @@ cog_directory_files_handler_get_property (GObject    *object,
         case PROP_STRIP_COMPONENTS:
             g_value_set_uint (value, cog_directory_files_handler_get_strip_components (handler));
             break;
+        case PROP_CACHE_SIZE:
+            g_value_set_uint64 (value, cog_directory_files_handler_get_cache_size (handler));
+            break;
+        case PROP_PRECOMPRESSED:
+            g_value_set_boolean (value, cog_directory_files_handler_get_precompressed (handler));
+            break;
+        case PROP_RESOLVE_TTL:
+            g_value_set_uint (value, cog_directory_files_handler_get_resolve_ttl (handler));
+            break;
+        case PROP_SMALL_FILE_SIZE:
+            g_value_set_uint64 (value, cog_directory_files_handler_get_small_file_size (handler));
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -326,6 +1289,22 @@ cog_directory_files_handler_set_property (GObject      *object,
             cog_directory_files_handler_set_strip_components (handler,
                                                               g_value_get_uint (value));
             break;
+        case PROP_CACHE_SIZE:
+            cog_directory_files_handler_set_cache_size (handler,
+                                                        g_value_get_uint64 (value));
+            break;
+        case PROP_PRECOMPRESSED:
+            cog_directory_files_handler_set_precompressed (handler,
+                                                           g_value_get_boolean (value));
+            break;
+        case PROP_RESOLVE_TTL:
+            cog_directory_files_handler_set_resolve_ttl (handler,
+                                                         g_value_get_uint (value));
+            break;
+        case PROP_SMALL_FILE_SIZE:
+            cog_directory_files_handler_set_small_file_size (handler,
+                                                             g_value_get_uint64 (value));
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -350,6 +1329,10 @@ cog_directory_files_handler_dispose (GObject *object)
 
     g_clear_object (&handler->base_path);
 
+    cog_directory_files_handler_cache_trim (handler, 0);
+    g_clear_pointer (&handler->cache, g_hash_table_unref);
+    g_clear_pointer (&handler->resolved, g_hash_table_unref);
+
     G_OBJECT_CLASS (cog_directory_files_handler_parent_class)->dispose (object);
 }
 
@@ -415,6 +1398,102 @@ cog_directory_files_handler_class_init (CogDirectoryFilesHandlerClass *klass)
                            G_PARAM_CONSTRUCT |
                            G_PARAM_STATIC_STRINGS);
 
+    /**
+     * CogDirectoryFilesHandler:cache-size: (attributes org.gtk.Property.get=cog_directory_files_handler_get_cache_size org.gtk.Property.set=cog_directory_files_handler_set_cache_size):
+     *
+     * Maximum amount of memory, in bytes, used to keep the contents of
+     * recently served files. Zero disables the cache.
+     *
+     * Cached contents are checked against the modification time of
+     * files before being used, so changes on disk are always picked up.
+     * Files bigger than a quarter of the cache size are never cached.
+     *
+     * Since: 0.20
+     */
+    s_properties[PROP_CACHE_SIZE] =
+        g_param_spec_uint64 ("cache-size",
+                             "Cache size",
+                             "Maximum size of the file contents cache, in bytes",
+                             0, G_MAXUINT64, 0,
+                             G_PARAM_READWRITE |
+                             G_PARAM_EXPLICIT_NOTIFY |
+                             G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogDirectoryFilesHandler:precompressed: (attributes org.gtk.Property.get=cog_directory_files_handler_get_precompressed org.gtk.Property.set=cog_directory_files_handler_set_precompressed):
+     *
+     * Whether to look for gzip-compressed versions of files.
+     *
+     * When enabled, a request which resolves to `some/file.js` checks
+     * whether `some/file.js.gz` exists, and if so its contents are
+     * decompressed on the fly as they are read. Otherwise the
+     * uncompressed file is used. This allows keeping only compressed
+     * files on storage. Directories, and the root of the served tree,
+     * are never replaced by a compressed sibling. Missing siblings are
+     * remembered as long as other resolved paths (see
+     * [property@Cog.DirectoryFilesHandler:resolve-ttl]).
+     *
+     * Compressed files are not kept in the content cache
+     * (see [property@Cog.DirectoryFilesHandler:cache-size]).
+     *
+     * Since: 0.20
+     */
+    s_properties[PROP_PRECOMPRESSED] =
+        g_param_spec_boolean ("precompressed",
+                              "Precompressed",
+                              "Look for gzip-compressed versions of files",
+                              FALSE,
+                              G_PARAM_READWRITE |
+                              G_PARAM_EXPLICIT_NOTIFY |
+                              G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogDirectoryFilesHandler:resolve-ttl: (attributes org.gtk.Property.get=cog_directory_files_handler_get_resolve_ttl org.gtk.Property.set=cog_directory_files_handler_set_resolve_ttl):
+     *
+     * Time, in milliseconds, during which the results of resolving paths
+     * are remembered. Zero disables remembering them.
+     *
+     * Requests for paths which resolved to a directory use its
+     * `index.html` file without checking the directory again, and
+     * requests for paths which were not found fail without accessing
+     * the file system. Changes on disk may take up to this long to be
+     * noticed.
+     *
+     * Since: 0.20
+     */
+    s_properties[PROP_RESOLVE_TTL] =
+        g_param_spec_uint ("resolve-ttl",
+                           "Resolve TTL",
+                           "Time to remember resolved paths, in milliseconds",
+                           0, G_MAXUINT, 0,
+                           G_PARAM_READWRITE |
+                           G_PARAM_EXPLICIT_NOTIFY |
+                           G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogDirectoryFilesHandler:small-file-size: (attributes org.gtk.Property.get=cog_directory_files_handler_get_small_file_size org.gtk.Property.set=cog_directory_files_handler_set_small_file_size):
+     *
+     * Maximum size, in bytes, of files read using the fast path for small
+     * files. Zero disables the fast path.
+     *
+     * Files up to this size are opened, checked and read into memory in
+     * a single operation done by a dedicated thread, which reduces the
+     * amount of main loop wake-ups needed to serve each of them. This
+     * helps keeping input latency steady while pages load many small
+     * resources. The fast path is not used when
+     * [property@Cog.DirectoryFilesHandler:precompressed] is enabled.
+     *
+     * Since: 0.20
+     */
+    s_properties[PROP_SMALL_FILE_SIZE] =
+        g_param_spec_uint64 ("small-file-size",
+                             "Small file size",
+                             "Maximum size of files read using the fast path, in bytes",
+                             0, G_MAXUINT64, 0,
+                             G_PARAM_READWRITE |
+                             G_PARAM_EXPLICIT_NOTIFY |
+                             G_PARAM_STATIC_STRINGS);
+
     g_object_class_install_properties (object_class, N_PROPERTIES, s_properties);
 }
 
@@ -546,3 +1625,173 @@ cog_directory_files_handler_set_strip_components (CogDirectoryFilesHandler *self
     self->strip_components = count;
     g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_STRIP_COMPONENTS]);
 }
+
+/**
+ * cog_directory_files_handler_get_cache_size:
+ * @self: a #CogDirectoryFilesHandler
+ *
+ * Gets the value of the [property@Cog.DirectoryFilesHandler:cache-size]
+ * property.
+ *
+ * Returns: Maximum size of the file contents cache, in bytes.
+ *
+ * Since: 0.20
+ */
+guint64
+cog_directory_files_handler_get_cache_size (CogDirectoryFilesHandler *self)
+{
+    g_return_val_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self), 0);
+    return self->cache_size;
+}
+
+/**
+ * cog_directory_files_handler_set_cache_size:
+ * @self: a #CogDirectoryFilesHandler
+ * @size: Maximum size of the file contents cache, in bytes.
+ *
+ * Sets the value of the [property@Cog.DirectoryFilesHandler:cache-size]
+ * property. Reducing the size evicts the least recently used entries
+ * as needed.
+ *
+ * Since: 0.20
+ */
+void
+cog_directory_files_handler_set_cache_size (CogDirectoryFilesHandler *self,
+                                            guint64                   size)
+{
+    g_return_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self));
+
+    if (self->cache_size == size)
+        return;
+
+    self->cache_size = size;
+    cog_directory_files_handler_cache_trim (self, size);
+
+    g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_CACHE_SIZE]);
+}
+
+/**
+ * cog_directory_files_handler_get_precompressed:
+ * @self: a #CogDirectoryFilesHandler
+ *
+ * Gets the value of the [property@Cog.DirectoryFilesHandler:precompressed]
+ * property.
+ *
+ * Returns: Whether gzip-compressed versions of files are looked up.
+ *
+ * Since: 0.20
+ */
+gboolean
+cog_directory_files_handler_get_precompressed (CogDirectoryFilesHandler *self)
+{
+    g_return_val_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self), FALSE);
+    return self->precompressed;
+}
+
+/**
+ * cog_directory_files_handler_set_precompressed:
+ * @self: a #CogDirectoryFilesHandler
+ * @precompressed: Whether to look up gzip-compressed versions of files.
+ *
+ * Sets the value of the [property@Cog.DirectoryFilesHandler:precompressed]
+ * property.
+ *
+ * Since: 0.20
+ */
+void
+cog_directory_files_handler_set_precompressed (CogDirectoryFilesHandler *self,
+                                               gboolean                  precompressed)
+{
+    g_return_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self));
+
+    precompressed = precompressed ? TRUE : FALSE;
+    if (self->precompressed == precompressed)
+        return;
+
+    self->precompressed = precompressed;
+    g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_PRECOMPRESSED]);
+}
+
+/**
+ * cog_directory_files_handler_get_resolve_ttl:
+ * @self: a #CogDirectoryFilesHandler
+ *
+ * Gets the value of the [property@Cog.DirectoryFilesHandler:resolve-ttl]
+ * property.
+ *
+ * Returns: Time during which resolved paths are remembered, in milliseconds.
+ *
+ * Since: 0.20
+ */
+unsigned
+cog_directory_files_handler_get_resolve_ttl (CogDirectoryFilesHandler *self)
+{
+    g_return_val_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self), 0);
+    return self->resolve_ttl;
+}
+
+/**
+ * cog_directory_files_handler_set_resolve_ttl:
+ * @self: a #CogDirectoryFilesHandler
+ * @ttl: Time during which to remember resolved paths, in milliseconds.
+ *
+ * Sets the value of the [property@Cog.DirectoryFilesHandler:resolve-ttl]
+ * property. Previously remembered paths are forgotten.
+ *
+ * Since: 0.20
+ */
+void
+cog_directory_files_handler_set_resolve_ttl (CogDirectoryFilesHandler *self,
+                                             unsigned                  ttl)
+{
+    g_return_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self));
+
+    if (self->resolve_ttl == ttl)
+        return;
+
+    self->resolve_ttl = ttl;
+    g_clear_pointer (&self->resolved, g_hash_table_unref);
+
+    g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_RESOLVE_TTL]);
+}
+
+/**
+ * cog_directory_files_handler_get_small_file_size:
+ * @self: a #CogDirectoryFilesHandler
+ *
+ * Gets the value of the [property@Cog.DirectoryFilesHandler:small-file-size]
+ * property.
+ *
+ * Returns: Maximum size of files read using the fast path, in bytes.
+ *
+ * Since: 0.20
+ */
+guint64
+cog_directory_files_handler_get_small_file_size (CogDirectoryFilesHandler *self)
+{
+    g_return_val_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self), 0);
+    return self->small_file_size;
+}
+
+/**
+ * cog_directory_files_handler_set_small_file_size:
+ * @self: a #CogDirectoryFilesHandler
+ * @size: Maximum size of files read using the fast path, in bytes.
+ *
+ * Sets the value of the [property@Cog.DirectoryFilesHandler:small-file-size]
+ * property.
+ *
+ * Since: 0.20
+ */
+void
+cog_directory_files_handler_set_small_file_size (CogDirectoryFilesHandler *self,
+                                                 guint64                   size)
+{
+    g_return_if_fail (COG_IS_DIRECTORY_FILES_HANDLER (self));
+
+    if (self->small_file_size == size)
+        return;
+
+    self->small_file_size = size;
+    g_object_notify_by_pspec (G_OBJECT (self), s_properties[PROP_SMALL_FILE_SIZE]);
+}
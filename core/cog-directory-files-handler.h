@@ -59,6 +59,38 @@ void               cog_directory_files_handler_set_strip_components
                                                                 (CogDirectoryFilesHandler *self,
                                                                  unsigned                  count);
 
+COG_API
+guint64            cog_directory_files_handler_get_cache_size   (CogDirectoryFilesHandler *self);
+
+COG_API
+void               cog_directory_files_handler_set_cache_size   (CogDirectoryFilesHandler *self,
+                                                                 guint64                   size);
+
+COG_API
+gboolean           cog_directory_files_handler_get_precompressed
+                                                                (CogDirectoryFilesHandler *self);
+
+COG_API
+void               cog_directory_files_handler_set_precompressed
+                                                                (CogDirectoryFilesHandler *self,
+                                                                 gboolean                  precompressed);
+
+COG_API
+unsigned           cog_directory_files_handler_get_resolve_ttl  (CogDirectoryFilesHandler *self);
+
+COG_API
+void               cog_directory_files_handler_set_resolve_ttl  (CogDirectoryFilesHandler *self,
+                                                                 unsigned                  ttl);
+
+COG_API
+guint64            cog_directory_files_handler_get_small_file_size
+                                                                (CogDirectoryFilesHandler *self);
+
+COG_API
+void               cog_directory_files_handler_set_small_file_size
+                                                                (CogDirectoryFilesHandler *self,
+                                                                 guint64                   size);
+
 G_END_DECLS
 
 #endif /* !COG_DIRECTORY_FILES_HANDLER_H */
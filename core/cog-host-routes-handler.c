@@ -7,6 +7,9 @@
 
 #include "cog-host-routes-handler.h"
 #include "cog-directory-files-handler.h"
+#include "cog-request-handler-private.h"
+#include "cog-route-trie.h"
+#include <string.h>
 
 /**
  * CogHostRoutesHandler:
@@ -26,6 +29,14 @@
  * are checked and the one that matches the URI *host* component
  * will handle the request.
  *
+ * Routes for hosts starting with a `*.` wildcard label match any host
+ * which has at least one more label in its place, e.g. `*.assets.local`
+ * matches `a.assets.local` and `b.c.assets.local` but not `assets.local`.
+ * Routes for exact hosts take precedence over wildcard ones, and longer
+ * wildcard routes over shorter ones. Routes are stored in a trie of host
+ * labels, from the rightmost one, so finding a route depends on the
+ * number of labels of the requested host and not on the number of routes.
+ *
  * This handler is typically used in tandem with
  * [class@Cog.DirectoryFilesHandler], the latter being typically a
  * fallback, or as the handler for a routed host.
@@ -52,7 +63,7 @@ struct _CogHostRoutesHandler {
     GObject parent;
 
     CogRequestHandler *fallback;
-    GHashTable *route; /* string -> CogRequestHandler */
+    CogRouteTrie      *routes; /* Reversed host labels -> CogRequestHandler */
 };
 
 enum {
@@ -79,20 +90,90 @@ cog_host_routes_handler_run_fallback(CogHostRoutesHandler *self, WebKitURIScheme
     }
 }
 
+/* Finds the label which precedes the given end position in a host name. */
+static inline const char *
+host_label_start(const char *host, const char *label_end)
+{
+    const char *label = label_end;
+    while (label > host && label[-1] != '.')
+        --label;
+    return label;
+}
+
+static CogRouteTrie *
+cog_host_routes_handler_get_node(CogHostRoutesHandler *self, const char *host, gboolean create)
+{
+    CogRouteTrie *node = self->routes;
+    for (const char *label_end = host + strlen(host); node;) {
+        const char *label = host_label_start(host, label_end);
+        node = create ? cog_route_trie_ensure_child(node, label, label_end - label)
+                      : cog_route_trie_get_child(node, label, label_end - label);
+        if (label == host)
+            break;
+        label_end = label - 1;
+    }
+    return node;
+}
+
+static CogRequestHandler *
+cog_host_routes_handler_lookup(CogHostRoutesHandler *self, const char *host)
+{
+    CogRequestHandler *wildcard_handler = NULL;
+    CogRouteTrie      *node = self->routes;
+
+    for (const char *label_end = host + strlen(host);;) {
+        /* Labels remain to be matched, so a wildcard at this level applies. */
+        CogRouteTrie *wildcard = cog_route_trie_get_child(node, "*", 1);
+        if (wildcard && cog_route_trie_get_value(wildcard))
+            wildcard_handler = cog_route_trie_get_value(wildcard);
+
+        const char *label = host_label_start(host, label_end);
+        node = cog_route_trie_get_child(node, label, label_end - label);
+        if (!node)
+            return wildcard_handler;
+        if (label == host)
+            break;
+        label_end = label - 1;
+    }
+
+    CogRequestHandler *handler = cog_route_trie_get_value(node);
+    return handler ? handler : wildcard_handler;
+}
+
+/* Removes a route, pruning nodes left unused. Returns whether it existed. */
+static gboolean
+cog_host_routes_handler_remove_route(CogRouteTrie *node, const char *host, const char *label_end)
+{
+    const char   *label = host_label_start(host, label_end);
+    CogRouteTrie *child = cog_route_trie_get_child(node, label, label_end - label);
+    if (!child)
+        return FALSE;
+
+    gboolean removed;
+    if (label == host) {
+        removed = cog_route_trie_get_value(child) != NULL;
+        cog_route_trie_set_value(child, NULL);
+    } else {
+        removed = cog_host_routes_handler_remove_route(child, host, label - 1);
+    }
+
+    cog_route_trie_prune_child(node, child);
+    return removed;
+}
+
 static void
 cog_host_routes_handler_run(CogRequestHandler *request_handler, WebKitURISchemeRequest *request)
 {
     CogHostRoutesHandler *self = COG_HOST_ROUTES_HANDLER(request_handler);
 
+    CogRequestUri *uri = cog_request_handler_get_request_uri(request);
 #if COG_USE_SOUP2
-    g_autoptr(SoupURI) uri = soup_uri_new(webkit_uri_scheme_request_get_uri(request));
-    const char *host = SOUP_URI_IS_VALID(uri) ? soup_uri_get_host(uri) : NULL;
+    const char *host = uri ? soup_uri_get_host(uri) : NULL;
 #else
-    g_autoptr(GUri) uri = g_uri_parse(webkit_uri_scheme_request_get_uri(request), G_URI_FLAGS_ENCODED, NULL);
     const char *host = uri ? g_uri_get_host(uri) : NULL;
 #endif
     if (host) {
-        CogRequestHandler *handler = g_hash_table_lookup(self->route, host);
+        CogRequestHandler *handler = cog_host_routes_handler_lookup(self, host);
         if (handler)
             return cog_request_handler_run(handler, request);
     }
@@ -143,8 +224,7 @@ cog_host_routes_handler_dispose(GObject *object)
 {
     CogHostRoutesHandler *self = COG_HOST_ROUTES_HANDLER(object);
 
-    g_hash_table_remove_all(self->route);
-    g_clear_pointer(&self->route, g_hash_table_unref);
+    g_clear_pointer(&self->routes, cog_route_trie_free);
 
     g_clear_object(&self->fallback);
 
@@ -178,7 +258,7 @@ cog_host_routes_handler_class_init(CogHostRoutesHandlerClass *klass)
 static void
 cog_host_routes_handler_init(CogHostRoutesHandler *self)
 {
-    self->route = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+    self->routes = cog_route_trie_new(g_object_unref);
 }
 
 /**
@@ -203,6 +283,9 @@ cog_host_routes_handler_new(CogRequestHandler *fallback_handler)
  *
  * Check if there is already added a route for the @host.
  *
+ * Note that this checks for a route added with exactly the same @host,
+ * a wildcard route which would match @host does not count.
+ *
  * Returns: Whether the route already exists.
  */
 gboolean
@@ -211,10 +294,8 @@ cog_host_routes_handler_contains(CogHostRoutesHandler *self, const char *host)
     g_return_val_if_fail(COG_IS_HOST_ROUTES_HANDLER(self), FALSE);
     g_return_val_if_fail(host != NULL, FALSE);
 
-    if (g_hash_table_contains(self->route, host))
-        return TRUE;
-
-    return FALSE;
+    CogRouteTrie *node = cog_host_routes_handler_get_node(self, host, FALSE);
+    return node && cog_route_trie_get_value(node);
 }
 
 /**
@@ -226,7 +307,8 @@ cog_host_routes_handler_contains(CogHostRoutesHandler *self, const char *host)
  * Adds a route to the handler.
  *
  * Configures a route which matches @host in URI, and dispatches
- * requests to a given @handler.
+ * requests to a given @handler. If @host starts with a `*.` wildcard
+ * label, the route matches all the subdomains of the rest of @host.
  *
  * Returns: Whether the route was successfully added.
  */
@@ -237,10 +319,11 @@ cog_host_routes_handler_add(CogHostRoutesHandler *self, const char *host, CogReq
     g_return_val_if_fail(host != NULL, FALSE);
     g_return_val_if_fail(COG_IS_REQUEST_HANDLER(handler), FALSE);
 
-    if (g_hash_table_contains(self->route, host))
+    CogRouteTrie *node = cog_host_routes_handler_get_node(self, host, TRUE);
+    if (cog_route_trie_get_value(node))
         return FALSE;
 
-    g_hash_table_insert(self->route, g_strdup(host), g_object_ref(handler));
+    cog_route_trie_set_value(node, g_object_ref(handler));
     return TRUE;
 }
 
@@ -263,7 +346,7 @@ cog_host_routes_handler_remove(CogHostRoutesHandler *self, const char *host)
     g_return_val_if_fail(COG_IS_HOST_ROUTES_HANDLER(self), FALSE);
     g_return_val_if_fail(host != NULL, FALSE);
 
-    return g_hash_table_remove(self->route, host);
+    return cog_host_routes_handler_remove_route(self->routes, host, host + strlen(host));
 }
 
 /**
@@ -7,6 +7,8 @@
 
 #include "cog-prefix-routes-handler.h"
 #include "cog-directory-files-handler.h"
+#include "cog-route-trie.h"
+#include <string.h>
 
 /**
  * CogPrefixRoutesHandler:
@@ -24,7 +26,9 @@
  * [method@Cog.PrefixRoutesHandler.mount] and
  * [method@Cog.PrefixRoutesHandler.unmount]. For each request, routes
  * are checked and the one that matches the most URI *path* components
- * will handle the request.
+ * will handle the request. Routes are stored in a trie of path components,
+ * so finding the matching route costs a single walk over the URI path,
+ * regardless of the number of routes.
  *
  * This handler is typically used in tandem with
  * [class@Cog.DirectoryFilesHandler], the latter being typically a
@@ -57,7 +61,7 @@ struct _CogPrefixRoutesHandler {
     GObject parent;
 
     CogRequestHandler *fallback;
-    GHashTable        *routes;  /* string -> CogRequestHandler */
+    CogRouteTrie      *routes;  /* Path components -> CogRequestHandler */
 };
 
 enum {
@@ -97,34 +101,40 @@ cog_prefix_routes_handler_run (CogRequestHandler      *request_handler,
     CogPrefixRoutesHandler *self = COG_PREFIX_ROUTES_HANDLER (request_handler);
 
     const char *uri_path = webkit_uri_scheme_request_get_path (request);
-    if (!uri_path)
+    if (!uri_path || uri_path[0] != '/')
         return cog_prefix_routes_handler_run_fallback (self, request);
 
     /*
-     * Try to find the longest path (up to a slash) for which there
-     * is a route configured.
+     * Find the longest path (up to a slash) for which there is a route
+     * configured. The last component is never part of the prefix, e.g.
+     * a route for "/a/b" matches "/a/b/" and "/a/b/c", but not "/a/b".
      */
-    g_autoptr(GString) prefix = g_string_new (uri_path);
+    CogRouteTrie *node = self->routes;
+    CogRequestHandler *handler = NULL;
+    const char *prefix_end = NULL;
 
-    while (prefix->len > 1) {
-        /* Find the position of the latest slash. */
-        size_t last_slash_pos = prefix->len - 1;
-        while (prefix->str[last_slash_pos] != '/' && last_slash_pos > 0)
-            --last_slash_pos;
-
-        /* Position 0 is always the leading slash. */
-        if (last_slash_pos == 0)
+    for (const char *segment = uri_path + 1;; ) {
+        const char *segment_end = strchr (segment, '/');
+        if (!segment_end)
             break;
 
-        g_string_erase (prefix, last_slash_pos, -1);
+        node = cog_route_trie_get_child (node, segment, segment_end - segment);
+        if (!node)
+            break;
 
-        CogRequestHandler *handler =
-            g_hash_table_lookup (self->routes, prefix->str);
-        if (handler) {
-            g_debug ("Chosen route '%s' for URI '%s'", prefix->str,
-                     webkit_uri_scheme_request_get_uri (request));
-            return cog_request_handler_run (handler, request);
+        CogRequestHandler *node_handler = cog_route_trie_get_value (node);
+        if (node_handler) {
+            handler = node_handler;
+            prefix_end = segment_end;
         }
+
+        segment = segment_end + 1;
+    }
+
+    if (handler) {
+        g_debug ("Chosen route '%.*s' for URI '%s'", (int) (prefix_end - uri_path), uri_path,
+                 webkit_uri_scheme_request_get_uri (request));
+        return cog_request_handler_run (handler, request);
     }
 
     cog_prefix_routes_handler_run_fallback (self, request);
@@ -185,8 +195,7 @@ cog_prefix_routes_handler_dispose (GObject *object)
 {
     CogPrefixRoutesHandler *self = COG_PREFIX_ROUTES_HANDLER (object);
 
-    g_hash_table_remove_all (self->routes);
-    g_clear_pointer (&self->routes, g_hash_table_unref);
+    g_clear_pointer (&self->routes, cog_route_trie_free);
 
     g_clear_object (&self->fallback);
 
@@ -224,10 +233,64 @@ cog_prefix_routes_handler_class_init (CogPrefixRoutesHandlerClass *klass)
 static void
 cog_prefix_routes_handler_init (CogPrefixRoutesHandler *self)
 {
-    self->routes = g_hash_table_new_full (g_str_hash,
-                                          g_str_equal,
-                                          g_free,
-                                          g_object_unref);
+    self->routes = cog_route_trie_new (g_object_unref);
+}
+
+
+/*
+ * Returns the trie node for a path prefix, optionally creating the nodes
+ * for its components. The root node corresponds to the "/" prefix.
+ */
+static CogRouteTrie*
+cog_prefix_routes_handler_get_node (CogPrefixRoutesHandler *self,
+                                    const char             *path_prefix,
+                                    gboolean                create)
+{
+    CogRouteTrie *node = self->routes;
+    if (path_prefix[1] == '\0')
+        return node;
+
+    for (const char *segment = path_prefix + 1; node; ) {
+        const char *segment_end = strchr (segment, '/');
+        const size_t length = segment_end ? (size_t) (segment_end - segment) : strlen (segment);
+
+        node = create ? cog_route_trie_ensure_child (node, segment, length)
+                      : cog_route_trie_get_child (node, segment, length);
+        if (!segment_end)
+            break;
+        segment = segment_end + 1;
+    }
+
+    return node;
+}
+
+
+/*
+ * Removes the handler for the path prefix starting at the given segment
+ * below a node, pruning nodes which are left unused. Returns whether a
+ * handler was removed.
+ */
+static gboolean
+cog_prefix_routes_handler_remove_route (CogRouteTrie *node,
+                                        const char   *segment)
+{
+    const char *segment_end = strchr (segment, '/');
+    const size_t length = segment_end ? (size_t) (segment_end - segment) : strlen (segment);
+
+    CogRouteTrie *child = cog_route_trie_get_child (node, segment, length);
+    if (!child)
+        return FALSE;
+
+    gboolean removed;
+    if (segment_end) {
+        removed = cog_prefix_routes_handler_remove_route (child, segment_end + 1);
+    } else {
+        removed = cog_route_trie_get_value (child) != NULL;
+        cog_route_trie_set_value (child, NULL);
+    }
+
+    cog_route_trie_prune_child (node, child);
+    return removed;
 }
 
 /**
@@ -271,12 +334,11 @@ cog_prefix_routes_handler_mount (CogPrefixRoutesHandler *self,
     g_return_val_if_fail (path_prefix[0] == '/', FALSE);
     g_return_val_if_fail (COG_IS_REQUEST_HANDLER (handler), FALSE);
 
-    if (g_hash_table_contains (self->routes, path_prefix))
+    CogRouteTrie *node = cog_prefix_routes_handler_get_node (self, path_prefix, TRUE);
+    if (cog_route_trie_get_value (node))
         return FALSE;
 
-    g_hash_table_insert (self->routes,
-                         g_strdup (path_prefix),
-                         g_object_ref (handler));
+    cog_route_trie_set_value (node, g_object_ref (handler));
     return TRUE;
 }
 
@@ -301,7 +363,13 @@ cog_prefix_routes_handler_unmount (CogPrefixRoutesHandler *self,
     g_return_val_if_fail (path_prefix != NULL, FALSE);
     g_return_val_if_fail (path_prefix[0] == '/', FALSE);
 
-    return g_hash_table_remove (self->routes, path_prefix);
+    if (path_prefix[1] == '\0') {
+        gboolean removed = cog_route_trie_get_value (self->routes) != NULL;
+        cog_route_trie_set_value (self->routes, NULL);
+        return removed;
+    }
+
+    return cog_prefix_routes_handler_remove_route (self->routes, path_prefix + 1);
 }
 
 /**
@@ -0,0 +1,775 @@
+/*
+ * cog-proxy-handler.c
+ * Copyright (C) 2023 Igalia S.L.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "cog-proxy-handler.h"
+#include "cog-request-handler-private.h"
+
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+#include <string.h>
+
+#define HAVE_WEBKIT_URI_SCHEME_RESPONSE     WEBKIT_CHECK_VERSION(2, 36, 0)
+#define HAVE_WEBKIT_URI_SCHEME_REQUEST_BODY WEBKIT_CHECK_VERSION(2, 40, 0)
+
+/**
+ * CogProxyHandler:
+ *
+ * Request handler implementation that forwards requests to a local HTTP
+ * server listening on a UNIX domain socket.
+ *
+ * This allows serving dynamic content from an application server running
+ * in the same machine without exposing it over TCP. Each request is sent
+ * to the server, and the body of its response is streamed to the web
+ * engine as it arrives, without buffering it. Connections are kept open
+ * and reused for later requests, up to a configurable amount of idle
+ * connections (see [property@Cog.ProxyHandler:max-idle-connections]).
+ *
+ * Requests are sent using HTTP/1.0 with `Connection: keep-alive`, which
+ * servers answer either with a `Content-Length` header, which allows
+ * reusing the connection, or by closing the connection at the end of
+ * the response. Chunked responses are not supported. With WebKit 2.36
+ * or newer the request method, request headers, and the response status
+ * and headers are forwarded as well. Request bodies are forwarded with
+ * WebKit 2.40 or newer.
+ *
+ * Since: 0.20
+ */
+
+#define DEFAULT_MAX_IDLE_CONNECTIONS 4
+#define RESPONSE_HEAD_MAX_SIZE       (64 * 1024)
+
+struct _CogProxyHandler {
+    GObject parent;
+
+    char           *socket_path;
+    GSocketAddress *address;
+    GSocketClient  *client;
+
+    unsigned max_idle_connections;
+    GMutex   idle_lock;        /* Connections are released from reader threads. */
+    GQueue   idle_connections; /* ProxyConnection, most recently used first. */
+};
+
+enum {
+    PROP_0,
+    PROP_SOCKET_PATH,
+    PROP_MAX_IDLE_CONNECTIONS,
+    N_PROPERTIES,
+};
+
+static GParamSpec *s_properties[N_PROPERTIES] = {
+    NULL,
+};
+
+static void cog_proxy_handler_iface_init(CogRequestHandlerInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(CogProxyHandler,
+                        cog_proxy_handler,
+                        G_TYPE_OBJECT,
+                        G_IMPLEMENT_INTERFACE(COG_TYPE_REQUEST_HANDLER, cog_proxy_handler_iface_init))
+
+/*
+ * Connection to the server. The buffered input stream is kept along with
+ * the connection, because it may contain data read ahead.
+ */
+typedef struct {
+    GSocketConnection *socket_connection;
+    GDataInputStream  *input;
+} ProxyConnection;
+
+static ProxyConnection *
+proxy_connection_new(GSocketConnection *socket_connection)
+{
+    ProxyConnection *connection = g_new0(ProxyConnection, 1);
+    connection->socket_connection = g_object_ref(socket_connection);
+    connection->input = g_data_input_stream_new(g_io_stream_get_input_stream(G_IO_STREAM(socket_connection)));
+    g_data_input_stream_set_newline_type(connection->input, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+    g_filter_input_stream_set_close_base_stream(G_FILTER_INPUT_STREAM(connection->input), FALSE);
+    return connection;
+}
+
+static void
+proxy_connection_free(ProxyConnection *connection)
+{
+    g_clear_object(&connection->input);
+    g_io_stream_close(G_IO_STREAM(connection->socket_connection), NULL, NULL);
+    g_clear_object(&connection->socket_connection);
+    g_free(connection);
+}
+
+static ProxyConnection *
+cog_proxy_handler_take_idle_connection(CogProxyHandler *self)
+{
+    g_mutex_lock(&self->idle_lock);
+    ProxyConnection *connection = g_queue_pop_head(&self->idle_connections);
+    g_mutex_unlock(&self->idle_lock);
+    return connection;
+}
+
+/* May be called from any thread. */
+static void
+cog_proxy_handler_release_connection(CogProxyHandler *self, ProxyConnection *connection, gboolean reusable)
+{
+    if (reusable) {
+        g_mutex_lock(&self->idle_lock);
+        if (self->idle_connections.length < self->max_idle_connections) {
+            g_queue_push_head(&self->idle_connections, g_steal_pointer(&connection));
+        }
+        g_mutex_unlock(&self->idle_lock);
+    }
+
+    if (connection)
+        proxy_connection_free(connection);
+}
+
+static void
+cog_proxy_handler_trim_idle_connections(CogProxyHandler *self, unsigned count)
+{
+    g_mutex_lock(&self->idle_lock);
+    while (self->idle_connections.length > count)
+        proxy_connection_free(g_queue_pop_tail(&self->idle_connections));
+    g_mutex_unlock(&self->idle_lock);
+}
+
+/*
+ * Input stream for response bodies, which reads up to the length of the
+ * body (or until the end of the stream if unknown) from the connection
+ * and releases the connection when closed.
+ */
+#define COG_TYPE_PROXY_BODY_STREAM (cog_proxy_body_stream_get_type())
+G_DECLARE_FINAL_TYPE(CogProxyBodyStream, cog_proxy_body_stream, COG, PROXY_BODY_STREAM, GFilterInputStream)
+
+struct _CogProxyBodyStream {
+    GFilterInputStream parent;
+
+    CogProxyHandler *handler;
+    ProxyConnection *connection;
+    gint64           remaining; /* Negative when reading until the end. */
+    gboolean         keep_alive;
+};
+
+G_DEFINE_TYPE(CogProxyBodyStream, cog_proxy_body_stream, G_TYPE_FILTER_INPUT_STREAM)
+
+static gssize
+cog_proxy_body_stream_read(GInputStream *stream, void *buffer, gsize count, GCancellable *cancellable, GError **error)
+{
+    CogProxyBodyStream *self = COG_PROXY_BODY_STREAM(stream);
+
+    if (self->remaining == 0)
+        return 0;
+    if (self->remaining > 0)
+        count = MIN(count, (guint64) self->remaining);
+
+    gssize n_read = g_input_stream_read(g_filter_input_stream_get_base_stream(G_FILTER_INPUT_STREAM(stream)), buffer,
+                                        count, cancellable, error);
+    if (n_read > 0 && self->remaining > 0) {
+        self->remaining -= n_read;
+    } else if (n_read == 0 && self->remaining > 0) {
+        self->keep_alive = FALSE;
+        g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT,
+                            "Connection closed before the end of the response body");
+        return -1;
+    } else if (n_read < 0) {
+        self->keep_alive = FALSE;
+    }
+    return n_read;
+}
+
+static gboolean
+cog_proxy_body_stream_close(GInputStream *stream, GCancellable *cancellable G_GNUC_UNUSED, GError **error G_GNUC_UNUSED)
+{
+    CogProxyBodyStream *self = COG_PROXY_BODY_STREAM(stream);
+
+    /* The connection can be reused only if the whole body was read. */
+    if (self->connection) {
+        cog_proxy_handler_release_connection(self->handler, g_steal_pointer(&self->connection),
+                                             self->keep_alive && self->remaining == 0);
+    }
+    return TRUE;
+}
+
+static void
+cog_proxy_body_stream_finalize(GObject *object)
+{
+    CogProxyBodyStream *self = COG_PROXY_BODY_STREAM(object);
+
+    if (self->connection)
+        cog_proxy_handler_release_connection(self->handler, g_steal_pointer(&self->connection), FALSE);
+    g_clear_object(&self->handler);
+
+    G_OBJECT_CLASS(cog_proxy_body_stream_parent_class)->finalize(object);
+}
+
+static void
+cog_proxy_body_stream_class_init(CogProxyBodyStreamClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS(klass);
+    object_class->finalize = cog_proxy_body_stream_finalize;
+
+    GInputStreamClass *stream_class = G_INPUT_STREAM_CLASS(klass);
+    stream_class->read_fn = cog_proxy_body_stream_read;
+    stream_class->close_fn = cog_proxy_body_stream_close;
+}
+
+static void
+cog_proxy_body_stream_init(CogProxyBodyStream *self G_GNUC_UNUSED)
+{
+}
+
+static GInputStream *
+cog_proxy_body_stream_new(CogProxyHandler *handler, ProxyConnection *connection, gint64 length, gboolean keep_alive)
+{
+    CogProxyBodyStream *self = g_object_new(COG_TYPE_PROXY_BODY_STREAM, "base-stream", connection->input,
+                                            "close-base-stream", FALSE, NULL);
+    self->handler = g_object_ref(handler);
+    self->connection = connection;
+    self->remaining = length;
+    self->keep_alive = keep_alive;
+    return G_INPUT_STREAM(self);
+}
+
+/*
+ * State kept while a request is being forwarded.
+ */
+typedef struct {
+    CogProxyHandler        *handler;
+    WebKitURISchemeRequest *request;
+    GBytes                 *message; /* Request head and body. */
+    ProxyConnection        *connection;
+    gboolean                reused;
+    gboolean                is_head;
+    gboolean                is_idempotent;
+    GString                *response_head;
+} ProxyRequest;
+
+static void
+proxy_request_free(ProxyRequest *self)
+{
+    if (self->connection)
+        cog_proxy_handler_release_connection(self->handler, g_steal_pointer(&self->connection), FALSE);
+    g_clear_object(&self->handler);
+    g_clear_object(&self->request);
+    g_clear_pointer(&self->message, g_bytes_unref);
+    g_string_free(self->response_head, TRUE);
+    g_free(self);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(ProxyRequest, proxy_request_free)
+
+static void proxy_request_connect(ProxyRequest *self);
+
+static gboolean
+header_is_hop_by_hop(const char *name)
+{
+    static const char *const hop_by_hop_headers[] = {
+        "Connection", "Keep-Alive", "Proxy-Connection", "TE", "Trailer", "Transfer-Encoding", "Upgrade",
+    };
+    for (unsigned i = 0; i < G_N_ELEMENTS(hop_by_hop_headers); i++) {
+        if (g_ascii_strcasecmp(name, hop_by_hop_headers[i]) == 0)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* Methods which may be safely sent again, see RFC 9110, section 9.2.2. */
+static gboolean
+method_is_idempotent(const char *method)
+{
+    static const char *const idempotent_methods[] = {
+        "GET", "HEAD", "OPTIONS", "TRACE", "PUT", "DELETE",
+    };
+    for (unsigned i = 0; i < G_N_ELEMENTS(idempotent_methods); i++) {
+        if (g_ascii_strcasecmp(method, idempotent_methods[i]) == 0)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static void
+proxy_request_build_message(ProxyRequest *self, GBytes *body)
+{
+    const char *method = "GET";
+#if HAVE_WEBKIT_URI_SCHEME_RESPONSE
+    if (webkit_uri_scheme_request_get_http_method(self->request))
+        method = webkit_uri_scheme_request_get_http_method(self->request);
+#endif
+    self->is_head = g_ascii_strcasecmp(method, "HEAD") == 0;
+    self->is_idempotent = method_is_idempotent(method);
+
+    CogRequestUri *uri = cog_request_handler_get_request_uri(self->request);
+#if COG_USE_SOUP2
+    const char *path = uri ? soup_uri_get_path(uri) : NULL;
+    const char *query = uri ? soup_uri_get_query(uri) : NULL;
+    const char *host = uri ? soup_uri_get_host(uri) : NULL;
+#else
+    const char *path = uri ? g_uri_get_path(uri) : NULL;
+    const char *query = uri ? g_uri_get_query(uri) : NULL;
+    const char *host = uri ? g_uri_get_host(uri) : NULL;
+#endif
+
+    GString *message = g_string_sized_new(512);
+    g_string_append_printf(message, "%s %s%s%s HTTP/1.0\r\n", method, (path && path[0]) ? path : "/", query ? "?" : "",
+                           query ? query : "");
+    g_string_append_printf(message, "Host: %s\r\nConnection: keep-alive\r\n", (host && host[0]) ? host : "localhost");
+
+#if HAVE_WEBKIT_URI_SCHEME_RESPONSE
+    SoupMessageHeaders *headers = webkit_uri_scheme_request_get_http_headers(self->request);
+    if (headers) {
+        SoupMessageHeadersIter iter;
+        const char            *name, *value;
+        soup_message_headers_iter_init(&iter, headers);
+        while (soup_message_headers_iter_next(&iter, &name, &value)) {
+            if (header_is_hop_by_hop(name) || g_ascii_strcasecmp(name, "Host") == 0 ||
+                g_ascii_strcasecmp(name, "Content-Length") == 0)
+                continue;
+            g_string_append_printf(message, "%s: %s\r\n", name, value);
+        }
+    }
+#endif
+
+    if (body)
+        g_string_append_printf(message, "Content-Length: %" G_GSIZE_FORMAT "\r\n", g_bytes_get_size(body));
+    g_string_append(message, "\r\n");
+
+    if (body) {
+        gsize       size;
+        const char *data = g_bytes_get_data(body, &size);
+        g_string_append_len(message, data, size);
+    }
+
+    self->message = g_string_free_to_bytes(message);
+}
+
+static void
+proxy_request_finish_response(ProxyRequest *self)
+{
+    g_autoptr(SoupMessageHeaders) headers = soup_message_headers_new(SOUP_MESSAGE_HEADERS_RESPONSE);
+    SoupHTTPVersion               version;
+    unsigned                      status;
+    g_autofree char              *reason = NULL;
+
+    if (!soup_headers_parse_response(self->response_head->str, self->response_head->len, headers, &version, &status,
+                                     &reason)) {
+        g_autoptr(GError) error =
+            g_error_new_literal(G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "Invalid response from proxied server");
+        webkit_uri_scheme_request_finish_error(self->request, error);
+        return;
+    }
+
+    gboolean keep_alive = (version == SOUP_HTTP_1_1)
+                              ? !soup_message_headers_header_contains(headers, "Connection", "close")
+                              : soup_message_headers_header_contains(headers, "Connection", "keep-alive");
+
+    gint64 length;
+    if (self->is_head || status < 200 || status == 204 || status == 304) {
+        length = 0;
+    } else {
+        switch (soup_message_headers_get_encoding(headers)) {
+        case SOUP_ENCODING_CONTENT_LENGTH:
+            length = soup_message_headers_get_content_length(headers);
+            break;
+        case SOUP_ENCODING_EOF:
+            length = -1;
+            keep_alive = FALSE;
+            break;
+        default: {
+            g_autoptr(GError) error = g_error_new_literal(G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                                                          "Unsupported transfer encoding from proxied server");
+            webkit_uri_scheme_request_finish_error(self->request, error);
+            return;
+        }
+        }
+    }
+
+    g_autofree char *content_type = g_strdup(soup_message_headers_get_one(headers, "Content-Type"));
+    soup_message_headers_remove(headers, "Connection");
+    soup_message_headers_remove(headers, "Keep-Alive");
+    soup_message_headers_remove(headers, "Transfer-Encoding");
+
+    g_autoptr(GInputStream) stream =
+        cog_proxy_body_stream_new(self->handler, g_steal_pointer(&self->connection), length, keep_alive);
+
+#if HAVE_WEBKIT_URI_SCHEME_RESPONSE
+    g_autoptr(WebKitURISchemeResponse) response = webkit_uri_scheme_response_new(stream, length);
+    webkit_uri_scheme_response_set_status(response, status, reason);
+    if (content_type)
+        webkit_uri_scheme_response_set_content_type(response, content_type);
+    webkit_uri_scheme_response_set_http_headers(response, g_steal_pointer(&headers));
+    webkit_uri_scheme_request_finish_with_response(self->request, response);
+#else
+    webkit_uri_scheme_request_finish(self->request, stream, length, content_type);
+#endif
+}
+
+/*
+ * A reused connection may have been closed by the server while idle,
+ * which is noticed when the request cannot be sent or when the response
+ * is empty. In that case the request is retried once with a new one.
+ * An empty response after the request was sent may also mean that the
+ * server processed it and then failed, so in that case only idempotent
+ * requests are retried, as others could end up being performed twice.
+ */
+static gboolean
+proxy_request_retry(ProxyRequest *self, gboolean request_sent)
+{
+    if (!self->reused || self->response_head->len > 0)
+        return FALSE;
+    if (request_sent && !self->is_idempotent)
+        return FALSE;
+
+    g_debug("%s: Retrying with a new connection to %s", G_STRFUNC, self->handler->socket_path);
+    cog_proxy_handler_release_connection(self->handler, g_steal_pointer(&self->connection), FALSE);
+    self->reused = FALSE;
+    proxy_request_connect(self);
+    return TRUE;
+}
+
+static void
+on_response_line_read(GObject *source_object, GAsyncResult *result, void *user_data)
+{
+    g_autoptr(ProxyRequest) self = user_data;
+    g_autoptr(GError)       error = NULL;
+    gsize                   length = 0;
+    g_autofree char        *line = g_data_input_stream_read_line_finish(G_DATA_INPUT_STREAM(source_object), result,
+                                                                        &length, &error);
+
+    if (!line) {
+        if (proxy_request_retry(self, TRUE)) {
+            g_steal_pointer(&self);
+            return;
+        }
+        if (!error) {
+            error = g_error_new_literal(G_IO_ERROR, G_IO_ERROR_CONNECTION_CLOSED,
+                                       "Connection closed by proxied server");
+        }
+        webkit_uri_scheme_request_finish_error(self->request, error);
+        return;
+    }
+
+    /* An empty line terminates the response head. */
+    if (length == 0 && self->response_head->len > 0) {
+        proxy_request_finish_response(self);
+        return;
+    }
+
+    g_string_append_len(self->response_head, line, length);
+    g_string_append(self->response_head, "\r\n");
+    if (self->response_head->len > RESPONSE_HEAD_MAX_SIZE) {
+        error = g_error_new_literal(G_IO_ERROR, G_IO_ERROR_MESSAGE_TOO_LARGE, "Response head from proxied server too big");
+        webkit_uri_scheme_request_finish_error(self->request, error);
+        return;
+    }
+
+    g_data_input_stream_read_line_async(self->connection->input, G_PRIORITY_DEFAULT, NULL, on_response_line_read,
+                                        g_steal_pointer(&self));
+}
+
+static void
+on_request_written(GObject *source_object, GAsyncResult *result, void *user_data)
+{
+    g_autoptr(ProxyRequest) self = user_data;
+    g_autoptr(GError)       error = NULL;
+
+    if (!g_output_stream_write_all_finish(G_OUTPUT_STREAM(source_object), result, NULL, &error)) {
+        if (proxy_request_retry(self, FALSE)) {
+            g_steal_pointer(&self);
+            return;
+        }
+        webkit_uri_scheme_request_finish_error(self->request, error);
+        return;
+    }
+
+    g_data_input_stream_read_line_async(self->connection->input, G_PRIORITY_DEFAULT, NULL, on_response_line_read,
+                                        g_steal_pointer(&self));
+}
+
+static void
+proxy_request_send(ProxyRequest *self)
+{
+    gsize       size;
+    const void *data = g_bytes_get_data(self->message, &size);
+
+    GOutputStream *output = g_io_stream_get_output_stream(G_IO_STREAM(self->connection->socket_connection));
+    g_output_stream_write_all_async(output, data, size, G_PRIORITY_DEFAULT, NULL, on_request_written, self);
+}
+
+static void
+on_connected(GObject *source_object, GAsyncResult *result, void *user_data)
+{
+    g_autoptr(ProxyRequest) self = user_data;
+    g_autoptr(GError)       error = NULL;
+
+    g_autoptr(GSocketConnection) socket_connection =
+        g_socket_client_connect_finish(G_SOCKET_CLIENT(source_object), result, &error);
+    if (!socket_connection) {
+        g_prefix_error(&error, "%s: ", self->handler->socket_path);
+        webkit_uri_scheme_request_finish_error(self->request, error);
+        return;
+    }
+
+    self->connection = proxy_connection_new(socket_connection);
+    proxy_request_send(g_steal_pointer(&self));
+}
+
+static void
+proxy_request_connect(ProxyRequest *self)
+{
+    g_socket_client_connect_async(self->handler->client, G_SOCKET_CONNECTABLE(self->handler->address), NULL,
+                                  on_connected, self);
+}
+
+static void
+proxy_request_start(ProxyRequest *self)
+{
+    self->connection = cog_proxy_handler_take_idle_connection(self->handler);
+    if (self->connection) {
+        self->reused = TRUE;
+        proxy_request_send(self);
+    } else {
+        proxy_request_connect(self);
+    }
+}
+
+#if HAVE_WEBKIT_URI_SCHEME_REQUEST_BODY
+static void
+on_request_body_read(GObject *source_object, GAsyncResult *result, void *user_data)
+{
+    g_autoptr(ProxyRequest) self = user_data;
+    g_autoptr(GError)       error = NULL;
+
+    if (g_output_stream_splice_finish(G_OUTPUT_STREAM(source_object), result, &error) < 0) {
+        webkit_uri_scheme_request_finish_error(self->request, error);
+        return;
+    }
+
+    g_autoptr(GBytes) body = g_memory_output_stream_steal_as_bytes(G_MEMORY_OUTPUT_STREAM(source_object));
+    proxy_request_build_message(self, body);
+    proxy_request_start(g_steal_pointer(&self));
+}
+#endif /* HAVE_WEBKIT_URI_SCHEME_REQUEST_BODY */
+
+static void
+cog_proxy_handler_run(CogRequestHandler *request_handler, WebKitURISchemeRequest *request)
+{
+    CogProxyHandler *self = COG_PROXY_HANDLER(request_handler);
+
+    ProxyRequest *proxy_request = g_new0(ProxyRequest, 1);
+    proxy_request->handler = g_object_ref(self);
+    proxy_request->request = g_object_ref(request);
+    proxy_request->response_head = g_string_sized_new(1024);
+
+#if HAVE_WEBKIT_URI_SCHEME_REQUEST_BODY
+    /* The body is needed in advance to send its length. */
+    g_autoptr(GInputStream) body = webkit_uri_scheme_request_get_http_body(request);
+    if (body) {
+        g_autoptr(GOutputStream) output = g_memory_output_stream_new_resizable();
+        g_output_stream_splice_async(output, body,
+                                     G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE | G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+                                     G_PRIORITY_DEFAULT, NULL, on_request_body_read, proxy_request);
+        return;
+    }
+#endif /* HAVE_WEBKIT_URI_SCHEME_REQUEST_BODY */
+
+    proxy_request_build_message(proxy_request, NULL);
+    proxy_request_start(proxy_request);
+}
+
+static void
+cog_proxy_handler_iface_init(CogRequestHandlerInterface *iface)
+{
+    iface->run = cog_proxy_handler_run;
+}
+
+static void
+cog_proxy_handler_get_property(GObject *object, unsigned prop_id, GValue *value, GParamSpec *pspec)
+{
+    CogProxyHandler *self = COG_PROXY_HANDLER(object);
+    switch (prop_id) {
+    case PROP_SOCKET_PATH:
+        g_value_set_string(value, self->socket_path);
+        break;
+    case PROP_MAX_IDLE_CONNECTIONS:
+        g_value_set_uint(value, cog_proxy_handler_get_max_idle_connections(self));
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    }
+}
+
+static void
+cog_proxy_handler_set_property(GObject *object, unsigned prop_id, const GValue *value, GParamSpec *pspec)
+{
+    CogProxyHandler *self = COG_PROXY_HANDLER(object);
+    switch (prop_id) {
+    case PROP_SOCKET_PATH:
+        g_free(self->socket_path);
+        self->socket_path = g_value_dup_string(value);
+        break;
+    case PROP_MAX_IDLE_CONNECTIONS:
+        cog_proxy_handler_set_max_idle_connections(self, g_value_get_uint(value));
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    }
+}
+
+static void
+cog_proxy_handler_constructed(GObject *object)
+{
+    G_OBJECT_CLASS(cog_proxy_handler_parent_class)->constructed(object);
+
+    CogProxyHandler *self = COG_PROXY_HANDLER(object);
+    g_return_if_fail(self->socket_path != NULL);
+
+    self->address = g_unix_socket_address_new(self->socket_path);
+    self->client = g_socket_client_new();
+}
+
+static void
+cog_proxy_handler_dispose(GObject *object)
+{
+    CogProxyHandler *self = COG_PROXY_HANDLER(object);
+
+    cog_proxy_handler_trim_idle_connections(self, 0);
+    g_clear_object(&self->client);
+    g_clear_object(&self->address);
+
+    G_OBJECT_CLASS(cog_proxy_handler_parent_class)->dispose(object);
+}
+
+static void
+cog_proxy_handler_finalize(GObject *object)
+{
+    CogProxyHandler *self = COG_PROXY_HANDLER(object);
+
+    g_free(self->socket_path);
+    g_mutex_clear(&self->idle_lock);
+
+    G_OBJECT_CLASS(cog_proxy_handler_parent_class)->finalize(object);
+}
+
+static void
+cog_proxy_handler_class_init(CogProxyHandlerClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS(klass);
+    object_class->get_property = cog_proxy_handler_get_property;
+    object_class->set_property = cog_proxy_handler_set_property;
+    object_class->constructed = cog_proxy_handler_constructed;
+    object_class->dispose = cog_proxy_handler_dispose;
+    object_class->finalize = cog_proxy_handler_finalize;
+
+    /**
+     * CogProxyHandler:socket-path: (attributes org.gtk.Property.get=cog_proxy_handler_get_socket_path)
+     *
+     * Path to the UNIX domain socket where the server listens.
+     *
+     * Since: 0.20
+     */
+    s_properties[PROP_SOCKET_PATH] =
+        g_param_spec_string("socket-path", NULL, NULL, NULL,
+                            G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogProxyHandler:max-idle-connections: (attributes org.gtk.Property.get=cog_proxy_handler_get_max_idle_connections org.gtk.Property.set=cog_proxy_handler_set_max_idle_connections)
+     *
+     * Maximum number of idle connections kept open for reuse. Zero
+     * disables reusing connections.
+     *
+     * Since: 0.20
+     */
+    s_properties[PROP_MAX_IDLE_CONNECTIONS] =
+        g_param_spec_uint("max-idle-connections", NULL, NULL, 0, G_MAXUINT, DEFAULT_MAX_IDLE_CONNECTIONS,
+                          G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+    g_object_class_install_properties(object_class, N_PROPERTIES, s_properties);
+}
+
+static void
+cog_proxy_handler_init(CogProxyHandler *self)
+{
+    self->max_idle_connections = DEFAULT_MAX_IDLE_CONNECTIONS;
+    g_mutex_init(&self->idle_lock);
+    g_queue_init(&self->idle_connections);
+}
+
+/**
+ * cog_proxy_handler_new: (constructor)
+ * @socket_path: Path to a UNIX domain socket.
+ *
+ * Create a new handler which forwards requests to the HTTP server
+ * listening on @socket_path.
+ *
+ * Returns: (transfer full): A proxy handler.
+ *
+ * Since: 0.20
+ */
+CogRequestHandler *
+cog_proxy_handler_new(const char *socket_path)
+{
+    g_return_val_if_fail(socket_path != NULL, NULL);
+
+    return g_object_new(COG_TYPE_PROXY_HANDLER, "socket-path", socket_path, NULL);
+}
+
+/**
+ * cog_proxy_handler_get_socket_path:
+ * @self: a proxy handler.
+ *
+ * Gets the path to the socket where requests are forwarded.
+ *
+ * Returns: (transfer none): Socket path.
+ *
+ * Since: 0.20
+ */
+const char *
+cog_proxy_handler_get_socket_path(CogProxyHandler *self)
+{
+    g_return_val_if_fail(COG_IS_PROXY_HANDLER(self), NULL);
+    return self->socket_path;
+}
+
+/**
+ * cog_proxy_handler_get_max_idle_connections:
+ * @self: a proxy handler.
+ *
+ * Gets the value of the [property@Cog.ProxyHandler:max-idle-connections]
+ * property.
+ *
+ * Returns: Maximum number of idle connections kept open.
+ *
+ * Since: 0.20
+ */
+unsigned
+cog_proxy_handler_get_max_idle_connections(CogProxyHandler *self)
+{
+    g_return_val_if_fail(COG_IS_PROXY_HANDLER(self), 0);
+    return self->max_idle_connections;
+}
+
+/**
+ * cog_proxy_handler_set_max_idle_connections:
+ * @self: a proxy handler.
+ * @count: Maximum number of idle connections to keep open.
+ *
+ * Sets the value of the [property@Cog.ProxyHandler:max-idle-connections]
+ * property. Reducing the value closes idle connections as needed.
+ *
+ * Since: 0.20
+ */
+void
+cog_proxy_handler_set_max_idle_connections(CogProxyHandler *self, unsigned count)
+{
+    g_return_if_fail(COG_IS_PROXY_HANDLER(self));
+
+    if (self->max_idle_connections == count)
+        return;
+
+    self->max_idle_connections = count;
+    cog_proxy_handler_trim_idle_connections(self, count);
+
+    g_object_notify_by_pspec(G_OBJECT(self), s_properties[PROP_MAX_IDLE_CONNECTIONS]);
+}
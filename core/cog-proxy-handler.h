@@ -0,0 +1,36 @@
+/*
+ * cog-proxy-handler.h
+ * Copyright (C) 2023 Igalia S.L.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#if !(defined(COG_INSIDE_COG__) && COG_INSIDE_COG__)
+#    error "Do not include this header directly, use <cog.h> instead"
+#endif
+
+#include "cog-export.h"
+#include "cog-request-handler.h"
+
+G_BEGIN_DECLS
+
+#define COG_TYPE_PROXY_HANDLER (cog_proxy_handler_get_type())
+
+COG_API
+G_DECLARE_FINAL_TYPE(CogProxyHandler, cog_proxy_handler, COG, PROXY_HANDLER, GObject)
+
+struct _CogProxyHandlerClass {
+    GObjectClass parent_class;
+};
+
+COG_API CogRequestHandler *cog_proxy_handler_new(const char *socket_path);
+
+COG_API const char *cog_proxy_handler_get_socket_path(CogProxyHandler *self);
+
+COG_API unsigned cog_proxy_handler_get_max_idle_connections(CogProxyHandler *self);
+
+COG_API void cog_proxy_handler_set_max_idle_connections(CogProxyHandler *self, unsigned count);
+
+G_END_DECLS
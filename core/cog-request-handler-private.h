@@ -0,0 +1,22 @@
+/*
+ * cog-request-handler-private.h
+ * Copyright (C) 2023 Igalia S.L.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "cog-request-handler.h"
+
+G_BEGIN_DECLS
+
+#if COG_USE_SOUP2
+typedef SoupURI CogRequestUri;
+#else
+typedef GUri CogRequestUri;
+#endif
+
+G_GNUC_INTERNAL CogRequestUri *cog_request_handler_get_request_uri(WebKitURISchemeRequest *request);
+
+G_END_DECLS
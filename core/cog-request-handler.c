@@ -5,7 +5,7 @@
  * SPDX-License-Identifier: MIT
  */
 
-#include "cog-request-handler.h"
+#include "cog-request-handler-private.h"
 
 /**
  * CogRequestHandler:
@@ -51,3 +51,40 @@ cog_request_handler_run (CogRequestHandler *handler, WebKitURISchemeRequest *req
     g_return_if_fail (iface->run != NULL);
     (*iface->run) (handler, request);
 }
+
+
+static G_DEFINE_QUARK (cog-request-uri, cog_request_uri)
+
+/*
+ * Nested handlers (e.g. host routes → prefix routes → directory files) may
+ * all need parts of the request URI which WebKit does not provide already
+ * parsed, like the host. The parsed URI is attached to the request the
+ * first time it is needed, so it is parsed once regardless of how many
+ * handlers a request goes through.
+ *
+ * Returns: (transfer none) (nullable): The parsed URI, or %NULL if the
+ *    URI cannot be parsed.
+ */
+CogRequestUri*
+cog_request_handler_get_request_uri (WebKitURISchemeRequest *request)
+{
+    g_return_val_if_fail (WEBKIT_IS_URI_SCHEME_REQUEST (request), NULL);
+
+    CogRequestUri *uri = g_object_get_qdata (G_OBJECT (request), cog_request_uri_quark ());
+    if (uri)
+        return uri;
+
+#if COG_USE_SOUP2
+    uri = soup_uri_new (webkit_uri_scheme_request_get_uri (request));
+    if (uri && !SOUP_URI_IS_VALID (uri))
+        g_clear_pointer (&uri, soup_uri_free);
+    if (uri)
+        g_object_set_qdata_full (G_OBJECT (request), cog_request_uri_quark (), uri, (GDestroyNotify) soup_uri_free);
+#else
+    uri = g_uri_parse (webkit_uri_scheme_request_get_uri (request), SOUP_HTTP_URI_FLAGS, NULL);
+    if (uri)
+        g_object_set_qdata_full (G_OBJECT (request), cog_request_uri_quark (), uri, (GDestroyNotify) g_uri_unref);
+#endif
+
+    return uri;
+}
@@ -0,0 +1,312 @@
+/*
+ * cog-resource-handler.c
+ * Copyright (C) 2023 Igalia S.L.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "cog-resource-handler.h"
+
+#include <gio/gio.h>
+#include <string.h>
+
+/**
+ * CogResourceHandler:
+ *
+ * Request handler implementation that loads content from a #GResource.
+ *
+ * Resources may be compiled into the program, or loaded from a bundle
+ * file created with `glib-compile-resources`, which is mapped into
+ * memory. Either way, serving a request does not involve file system
+ * operations, and resources stored uncompressed are served without
+ * copying their contents.
+ *
+ * Only the path component of requested URIs is taken into account, and
+ * it is looked up relative to the [property@Cog.ResourceHandler:base-path]
+ * of the handler. Paths which end in a slash, or which match no resource,
+ * are also looked up with `index.html` appended.
+ *
+ * The following serves a user interface compiled into the program with
+ * a `/com/example/app/ui` resource prefix:
+ *
+ * ```c
+ * CogRequestHandler *handler = cog_resource_handler_new (NULL, "/com/example/app/ui");
+ * cog_shell_set_request_handler (shell, "app", handler);
+ * ```
+ *
+ * Since: 0.20
+ */
+
+struct _CogResourceHandler {
+    GObject parent;
+
+    GResource *resource;
+    char      *base_path;
+};
+
+enum {
+    PROP_0,
+    PROP_RESOURCE,
+    PROP_BASE_PATH,
+    N_PROPERTIES,
+};
+
+static GParamSpec *s_properties[N_PROPERTIES] = {
+    NULL,
+};
+
+static void cog_resource_handler_iface_init(CogRequestHandlerInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(CogResourceHandler,
+                        cog_resource_handler,
+                        G_TYPE_OBJECT,
+                        G_IMPLEMENT_INTERFACE(COG_TYPE_REQUEST_HANDLER, cog_resource_handler_iface_init))
+
+static GBytes *
+cog_resource_handler_lookup_data(CogResourceHandler *self, const char *path, GError **error)
+{
+    if (self->resource)
+        return g_resource_lookup_data(self->resource, path, G_RESOURCE_LOOKUP_FLAGS_NONE, error);
+    return g_resources_lookup_data(path, G_RESOURCE_LOOKUP_FLAGS_NONE, error);
+}
+
+static gboolean
+path_has_dot_dot_component(const char *path)
+{
+    g_auto(GStrv) components = g_strsplit(path, "/", -1);
+    for (unsigned i = 0; components[i]; i++) {
+        if (strcmp(components[i], "..") == 0)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static void
+cog_resource_handler_run(CogRequestHandler *request_handler, WebKitURISchemeRequest *request)
+{
+    CogResourceHandler *self = COG_RESOURCE_HANDLER(request_handler);
+
+    /*
+     * If we get an empty path, redirect to the root resource "/", otherwise
+     * subresources cannot load properly as there would be no base URI.
+     */
+    const char *request_path = webkit_uri_scheme_request_get_path(request);
+    if (!request_path || request_path[0] != '/') {
+        g_autofree char *uri_string = g_strconcat(webkit_uri_scheme_request_get_uri(request), "/", NULL);
+        webkit_web_view_load_uri(webkit_uri_scheme_request_get_web_view(request), uri_string);
+        return;
+    }
+
+    g_autofree char *path = g_uri_unescape_string(request_path, NULL);
+    if (!path || path_has_dot_dot_component(path)) {
+        g_autoptr(GError) error =
+            g_error_new(G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT, "Invalid URI path: %s", request_path);
+        webkit_uri_scheme_request_finish_error(request, error);
+        return;
+    }
+
+    const char *relative_path = path;
+    while (relative_path[0] == '/')
+        ++relative_path;
+
+    const gboolean    is_directory = relative_path[0] == '\0' || g_str_has_suffix(relative_path, "/");
+    g_autofree char  *resource_path = g_build_path("/", self->base_path, relative_path, NULL);
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GBytes) contents = NULL;
+
+    if (!is_directory) {
+        contents = cog_resource_handler_lookup_data(self, resource_path, &error);
+        if (!contents && !g_error_matches(error, G_RESOURCE_ERROR, G_RESOURCE_ERROR_NOT_FOUND)) {
+            webkit_uri_scheme_request_finish_error(request, error);
+            return;
+        }
+    }
+
+    if (!contents) {
+        char *index_path = g_build_path("/", resource_path, "index.html", NULL);
+        g_free(g_steal_pointer(&resource_path));
+        resource_path = index_path;
+
+        g_clear_error(&error);
+        contents = cog_resource_handler_lookup_data(self, resource_path, &error);
+        if (!contents) {
+            webkit_uri_scheme_request_finish_error(request, error);
+            return;
+        }
+    }
+
+    gsize            size;
+    const void      *data = g_bytes_get_data(contents, &size);
+    g_autofree char *mime_type = g_content_type_guess(resource_path, data, size, NULL);
+
+    g_autoptr(GInputStream) stream = g_memory_input_stream_new_from_bytes(contents);
+    webkit_uri_scheme_request_finish(request, stream, size, mime_type);
+}
+
+static void
+cog_resource_handler_iface_init(CogRequestHandlerInterface *iface)
+{
+    iface->run = cog_resource_handler_run;
+}
+
+static void
+cog_resource_handler_get_property(GObject *object, unsigned prop_id, GValue *value, GParamSpec *pspec)
+{
+    CogResourceHandler *self = COG_RESOURCE_HANDLER(object);
+    switch (prop_id) {
+    case PROP_RESOURCE:
+        g_value_set_boxed(value, self->resource);
+        break;
+    case PROP_BASE_PATH:
+        g_value_set_string(value, self->base_path);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    }
+}
+
+static void
+cog_resource_handler_set_property(GObject *object, unsigned prop_id, const GValue *value, GParamSpec *pspec)
+{
+    CogResourceHandler *self = COG_RESOURCE_HANDLER(object);
+    switch (prop_id) {
+    case PROP_RESOURCE:
+        g_clear_pointer(&self->resource, g_resource_unref);
+        self->resource = g_value_dup_boxed(value);
+        break;
+    case PROP_BASE_PATH:
+        g_free(self->base_path);
+        self->base_path = g_value_dup_string(value);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    }
+}
+
+static void
+cog_resource_handler_constructed(GObject *object)
+{
+    G_OBJECT_CLASS(cog_resource_handler_parent_class)->constructed(object);
+
+    CogResourceHandler *self = COG_RESOURCE_HANDLER(object);
+    if (!self->base_path)
+        self->base_path = g_strdup("/");
+}
+
+static void
+cog_resource_handler_dispose(GObject *object)
+{
+    CogResourceHandler *self = COG_RESOURCE_HANDLER(object);
+
+    g_clear_pointer(&self->resource, g_resource_unref);
+
+    G_OBJECT_CLASS(cog_resource_handler_parent_class)->dispose(object);
+}
+
+static void
+cog_resource_handler_finalize(GObject *object)
+{
+    CogResourceHandler *self = COG_RESOURCE_HANDLER(object);
+
+    g_free(self->base_path);
+
+    G_OBJECT_CLASS(cog_resource_handler_parent_class)->finalize(object);
+}
+
+static void
+cog_resource_handler_class_init(CogResourceHandlerClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS(klass);
+    object_class->get_property = cog_resource_handler_get_property;
+    object_class->set_property = cog_resource_handler_set_property;
+    object_class->constructed = cog_resource_handler_constructed;
+    object_class->dispose = cog_resource_handler_dispose;
+    object_class->finalize = cog_resource_handler_finalize;
+
+    /**
+     * CogResourceHandler:resource: (attributes org.gtk.Property.get=cog_resource_handler_get_resource)
+     *
+     * Resource bundle from which to load resources. If %NULL, resources
+     * are looked up in all the globally registered bundles, including
+     * those compiled into the program.
+     *
+     * Since: 0.20
+     */
+    s_properties[PROP_RESOURCE] = g_param_spec_boxed("resource", NULL, NULL, G_TYPE_RESOURCE,
+                                                     G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                                                         G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogResourceHandler:base-path: (attributes org.gtk.Property.get=cog_resource_handler_get_base_path)
+     *
+     * Resource path prefix under which requested paths are looked up.
+     *
+     * Since: 0.20
+     */
+    s_properties[PROP_BASE_PATH] =
+        g_param_spec_string("base-path", NULL, NULL, "/",
+                            G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+
+    g_object_class_install_properties(object_class, N_PROPERTIES, s_properties);
+}
+
+static void
+cog_resource_handler_init(CogResourceHandler *self G_GNUC_UNUSED)
+{
+}
+
+/**
+ * cog_resource_handler_new: (constructor)
+ * @resource: (nullable): Resource bundle.
+ * @base_path: (nullable): Resource path prefix.
+ *
+ * Create a new handler which serves resources from @resource, or from
+ * the globally registered resources if %NULL. Requested paths are looked
+ * up under @base_path, which defaults to `/` if %NULL.
+ *
+ * Returns: (transfer full): A resource handler.
+ *
+ * Since: 0.20
+ */
+CogRequestHandler *
+cog_resource_handler_new(GResource *resource, const char *base_path)
+{
+    g_return_val_if_fail(!base_path || base_path[0] == '/', NULL);
+
+    return g_object_new(COG_TYPE_RESOURCE_HANDLER, "resource", resource, "base-path", base_path, NULL);
+}
+
+/**
+ * cog_resource_handler_get_resource:
+ * @self: a resource handler.
+ *
+ * Gets the resource bundle used by the handler.
+ *
+ * Returns: (transfer none) (nullable): Resource bundle, or %NULL if the
+ *    handler uses the globally registered resources.
+ *
+ * Since: 0.20
+ */
+GResource *
+cog_resource_handler_get_resource(CogResourceHandler *self)
+{
+    g_return_val_if_fail(COG_IS_RESOURCE_HANDLER(self), NULL);
+    return self->resource;
+}
+
+/**
+ * cog_resource_handler_get_base_path:
+ * @self: a resource handler.
+ *
+ * Gets the resource path prefix used by the handler.
+ *
+ * Returns: (transfer none): Resource path prefix.
+ *
+ * Since: 0.20
+ */
+const char *
+cog_resource_handler_get_base_path(CogResourceHandler *self)
+{
+    g_return_val_if_fail(COG_IS_RESOURCE_HANDLER(self), NULL);
+    return self->base_path;
+}
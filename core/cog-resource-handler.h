@@ -0,0 +1,34 @@
+/*
+ * cog-resource-handler.h
+ * Copyright (C) 2023 Igalia S.L.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#if !(defined(COG_INSIDE_COG__) && COG_INSIDE_COG__)
+#    error "Do not include this header directly, use <cog.h> instead"
+#endif
+
+#include "cog-export.h"
+#include "cog-request-handler.h"
+
+G_BEGIN_DECLS
+
+#define COG_TYPE_RESOURCE_HANDLER (cog_resource_handler_get_type())
+
+COG_API
+G_DECLARE_FINAL_TYPE(CogResourceHandler, cog_resource_handler, COG, RESOURCE_HANDLER, GObject)
+
+struct _CogResourceHandlerClass {
+    GObjectClass parent_class;
+};
+
+COG_API CogRequestHandler *cog_resource_handler_new(GResource *resource, const char *base_path);
+
+COG_API GResource *cog_resource_handler_get_resource(CogResourceHandler *self);
+
+COG_API const char *cog_resource_handler_get_base_path(CogResourceHandler *self);
+
+G_END_DECLS
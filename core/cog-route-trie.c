@@ -0,0 +1,140 @@
+/*
+ * cog-route-trie.c
+ * Copyright (C) 2023 Igalia S.L.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "cog-route-trie.h"
+
+#include <string.h>
+
+struct _CogRouteTrie {
+    char          *segment; /* NULL for the root node. */
+    size_t         length;
+    void          *value;
+    GDestroyNotify value_destroy;
+    GPtrArray     *children; /* CogRouteTrie, sorted by segment. */
+};
+
+CogRouteTrie *
+cog_route_trie_new(GDestroyNotify value_destroy)
+{
+    CogRouteTrie *self = g_new0(CogRouteTrie, 1);
+    self->value_destroy = value_destroy;
+    return self;
+}
+
+void
+cog_route_trie_free(CogRouteTrie *self)
+{
+    g_return_if_fail(self != NULL);
+
+    if (self->value && self->value_destroy)
+        self->value_destroy(self->value);
+    g_clear_pointer(&self->children, g_ptr_array_unref);
+    g_free(self->segment);
+    g_free(self);
+}
+
+static int
+compare_segment(const CogRouteTrie *node, const char *segment, size_t length)
+{
+    int result = memcmp(node->segment, segment, MIN(node->length, length));
+    if (result != 0)
+        return result;
+    return (node->length > length) - (node->length < length);
+}
+
+/*
+ * Returns whether a child for the segment exists, and stores either its
+ * position or the position where it should be inserted.
+ */
+static gboolean
+cog_route_trie_find_child(CogRouteTrie *self, const char *segment, size_t length, unsigned *position)
+{
+    unsigned low = 0, high = self->children ? self->children->len : 0;
+    while (low < high) {
+        const unsigned middle = low + (high - low) / 2;
+        int result = compare_segment(g_ptr_array_index(self->children, middle), segment, length);
+        if (result == 0) {
+            *position = middle;
+            return TRUE;
+        }
+        if (result < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    *position = low;
+    return FALSE;
+}
+
+CogRouteTrie *
+cog_route_trie_get_child(CogRouteTrie *self, const char *segment, size_t length)
+{
+    g_return_val_if_fail(self != NULL, NULL);
+
+    unsigned position;
+    if (!cog_route_trie_find_child(self, segment, length, &position))
+        return NULL;
+    return g_ptr_array_index(self->children, position);
+}
+
+CogRouteTrie *
+cog_route_trie_ensure_child(CogRouteTrie *self, const char *segment, size_t length)
+{
+    g_return_val_if_fail(self != NULL, NULL);
+
+    unsigned position;
+    if (cog_route_trie_find_child(self, segment, length, &position))
+        return g_ptr_array_index(self->children, position);
+
+    CogRouteTrie *child = cog_route_trie_new(self->value_destroy);
+    child->segment = g_strndup(segment, length);
+    child->length = length;
+
+    if (!self->children)
+        self->children = g_ptr_array_new_with_free_func((GDestroyNotify) cog_route_trie_free);
+    g_ptr_array_insert(self->children, position, child);
+    return child;
+}
+
+/*
+ * Removes a child node if it holds no value and has no children itself,
+ * which is useful after clearing the value of a node.
+ */
+void
+cog_route_trie_prune_child(CogRouteTrie *self, CogRouteTrie *child)
+{
+    g_return_if_fail(self != NULL);
+    g_return_if_fail(child != NULL);
+
+    if (child->value || (child->children && child->children->len))
+        return;
+
+    unsigned position;
+    if (cog_route_trie_find_child(self, child->segment, child->length, &position))
+        g_ptr_array_remove_index(self->children, position);
+}
+
+void *
+cog_route_trie_get_value(CogRouteTrie *self)
+{
+    g_return_val_if_fail(self != NULL, NULL);
+    return self->value;
+}
+
+void
+cog_route_trie_set_value(CogRouteTrie *self, void *value)
+{
+    g_return_if_fail(self != NULL);
+
+    if (self->value == value)
+        return;
+
+    void *old_value = g_steal_pointer(&self->value);
+    self->value = value;
+    if (old_value && self->value_destroy)
+        self->value_destroy(old_value);
+}
@@ -0,0 +1,35 @@
+/*
+ * cog-route-trie.h
+ * Copyright (C) 2023 Igalia S.L.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Trie keyed by sequences of segments (path components, host labels),
+ * where each node may hold a value. Children are kept sorted, so finding
+ * the child for a segment is a binary search which needs neither copying
+ * nor NUL-terminating the segment. Walking the trie is left to callers,
+ * which know how to split their keys.
+ */
+typedef struct _CogRouteTrie CogRouteTrie;
+
+G_GNUC_INTERNAL CogRouteTrie *cog_route_trie_new(GDestroyNotify value_destroy);
+G_GNUC_INTERNAL void          cog_route_trie_free(CogRouteTrie *self);
+
+G_GNUC_INTERNAL CogRouteTrie *cog_route_trie_get_child(CogRouteTrie *self, const char *segment, size_t length);
+G_GNUC_INTERNAL CogRouteTrie *cog_route_trie_ensure_child(CogRouteTrie *self, const char *segment, size_t length);
+G_GNUC_INTERNAL void          cog_route_trie_prune_child(CogRouteTrie *self, CogRouteTrie *child);
+
+G_GNUC_INTERNAL void *cog_route_trie_get_value(CogRouteTrie *self);
+G_GNUC_INTERNAL void  cog_route_trie_set_value(CogRouteTrie *self, void *value);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(CogRouteTrie, cog_route_trie_free)
+
+G_END_DECLS
@@ -551,3 +551,248 @@ cog_view_is_fullscreen(CogView *self)
 
     return FALSE;
 }
+
+typedef struct {
+    GBytes             *pixels;
+    unsigned            width;
+    unsigned            height;
+    unsigned            stride;
+    CogScreenshotFormat format;
+    GOutputStream      *stream;
+} ScreenshotData;
+
+static void
+screenshot_data_free(ScreenshotData *data)
+{
+    g_clear_pointer(&data->pixels, g_bytes_unref);
+    g_clear_object(&data->stream);
+    g_free(data);
+}
+
+static uint32_t
+png_crc32_update(uint32_t crc, const uint8_t *data, size_t size)
+{
+    static uint32_t table[256];
+    static gsize    table_initialized = 0;
+
+    if (g_once_init_enter(&table_initialized)) {
+        for (uint32_t n = 0; n < G_N_ELEMENTS(table); n++) {
+            uint32_t c = n;
+            for (unsigned k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        g_once_init_leave(&table_initialized, 1);
+    }
+
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static gboolean
+png_write_chunk(GOutputStream *stream,
+                const char    *type,
+                const void    *data,
+                size_t         size,
+                GCancellable  *cancellable,
+                GError       **error)
+{
+    const uint32_t size_be = GUINT32_TO_BE(size);
+    uint32_t       crc = png_crc32_update(0xFFFFFFFF, (const uint8_t *) type, 4);
+    crc = GUINT32_TO_BE(png_crc32_update(crc, data, size) ^ 0xFFFFFFFF);
+
+    return g_output_stream_write_all(stream, &size_be, sizeof(size_be), NULL, cancellable, error) &&
+           g_output_stream_write_all(stream, type, 4, NULL, cancellable, error) &&
+           (size == 0 || g_output_stream_write_all(stream, data, size, NULL, cancellable, error)) &&
+           g_output_stream_write_all(stream, &crc, sizeof(crc), NULL, cancellable, error);
+}
+
+static gboolean
+screenshot_write_png(ScreenshotData *data, GCancellable *cancellable, GError **error)
+{
+    static const uint8_t png_signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    /* Image data is compressed into memory, to be written as a single IDAT chunk. */
+    g_autoptr(GOutputStream)   compressed = g_memory_output_stream_new_resizable();
+    g_autoptr(GZlibCompressor) compressor = g_zlib_compressor_new(G_ZLIB_COMPRESSOR_FORMAT_ZLIB, -1);
+    g_autoptr(GOutputStream)   zstream = g_converter_output_stream_new(compressed, G_CONVERTER(compressor));
+
+    const uint8_t *pixels = g_bytes_get_data(data->pixels, NULL);
+    g_autofree uint8_t *scanline = g_malloc(1 + 4 * (size_t) data->width);
+    scanline[0] = 0; /* Filter type: None. */
+
+    for (unsigned y = 0; y < data->height; y++) {
+        const uint32_t *row = (const uint32_t *) (pixels + (size_t) y * data->stride);
+        uint8_t        *out = scanline + 1;
+
+        for (unsigned x = 0; x < data->width; x++) {
+            const uint32_t argb = row[x];
+            const uint8_t  a = argb >> 24;
+            uint8_t        r = (argb >> 16) & 0xFF;
+            uint8_t        g = (argb >> 8) & 0xFF;
+            uint8_t        b = argb & 0xFF;
+
+            /* PNG does not use premultiplied alpha. */
+            if (a != 0xFF && a != 0) {
+                r = MIN(255, (r * 255 + a / 2) / a);
+                g = MIN(255, (g * 255 + a / 2) / a);
+                b = MIN(255, (b * 255 + a / 2) / a);
+            }
+
+            *out++ = r;
+            *out++ = g;
+            *out++ = b;
+            *out++ = a;
+        }
+
+        if (!g_output_stream_write_all(zstream, scanline, 1 + 4 * (size_t) data->width, NULL, cancellable, error))
+            return FALSE;
+    }
+
+    if (!g_output_stream_close(zstream, cancellable, error))
+        return FALSE;
+
+    g_autoptr(GBytes) idat = g_memory_output_stream_steal_as_bytes(G_MEMORY_OUTPUT_STREAM(compressed));
+
+    struct __attribute__((packed)) {
+        uint32_t width;
+        uint32_t height;
+        uint8_t  bit_depth;
+        uint8_t  color_type;
+        uint8_t  compression_method;
+        uint8_t  filter_method;
+        uint8_t  interlace_method;
+    } ihdr = {
+        .width = GUINT32_TO_BE(data->width),
+        .height = GUINT32_TO_BE(data->height),
+        .bit_depth = 8,
+        .color_type = 6, /* Truecolor with alpha. */
+    };
+
+    gsize         idat_size;
+    gconstpointer idat_data = g_bytes_get_data(idat, &idat_size);
+
+    return g_output_stream_write_all(data->stream, png_signature, sizeof(png_signature), NULL, cancellable, error) &&
+           png_write_chunk(data->stream, "IHDR", &ihdr, sizeof(ihdr), cancellable, error) &&
+           png_write_chunk(data->stream, "IDAT", idat_data, idat_size, cancellable, error) &&
+           png_write_chunk(data->stream, "IEND", NULL, 0, cancellable, error);
+}
+
+static gboolean
+screenshot_write_raw(ScreenshotData *data, GCancellable *cancellable, GError **error)
+{
+    const uint8_t *pixels = g_bytes_get_data(data->pixels, NULL);
+    const size_t   row_size = 4 * (size_t) data->width;
+
+    if (data->stride == row_size)
+        return g_output_stream_write_all(data->stream, pixels, row_size * data->height, NULL, cancellable, error);
+
+    for (unsigned y = 0; y < data->height; y++) {
+        if (!g_output_stream_write_all(data->stream, pixels + (size_t) y * data->stride, row_size, NULL, cancellable,
+                                       error))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static void
+screenshot_thread(GTask *task, void *source_object G_GNUC_UNUSED, ScreenshotData *data, GCancellable *cancellable)
+{
+    g_autoptr(GError) error = NULL;
+    gboolean          success = FALSE;
+
+    switch (data->format) {
+    case COG_SCREENSHOT_FORMAT_PNG:
+        success = screenshot_write_png(data, cancellable, &error);
+        break;
+    case COG_SCREENSHOT_FORMAT_RAW:
+        success = screenshot_write_raw(data, cancellable, &error);
+        break;
+    default:
+        g_assert_not_reached();
+    }
+
+    if (success && !g_output_stream_flush(data->stream, cancellable, &error))
+        success = FALSE;
+
+    if (success)
+        g_task_return_boolean(task, TRUE);
+    else
+        g_task_return_error(task, g_steal_pointer(&error));
+}
+
+/**
+ * cog_view_save_screenshot_async:
+ * @self: A view.
+ * @stream: (transfer none): Stream where to write the screenshot.
+ * @format: Output format.
+ * @cancellable: (nullable): A cancellable.
+ * @callback: Function to call when the screenshot has been written.
+ * @userdata: User data passed to @callback.
+ *
+ * Saves the contents of the last frame rendered by the view.
+ *
+ * The frame is captured immediately, and then encoded and written to
+ * the @stream in a worker thread. The stream is flushed, but not closed.
+ *
+ * Note that not all platform plug-ins may support capturing frames, and
+ * in that case the operation fails with %G_IO_ERROR_NOT_SUPPORTED.
+ *
+ * Since: 0.20
+ */
+void
+cog_view_save_screenshot_async(CogView            *self,
+                               GOutputStream      *stream,
+                               CogScreenshotFormat format,
+                               GCancellable       *cancellable,
+                               GAsyncReadyCallback callback,
+                               void               *userdata)
+{
+    g_return_if_fail(COG_IS_VIEW(self));
+    g_return_if_fail(G_IS_OUTPUT_STREAM(stream));
+    g_return_if_fail(format == COG_SCREENSHOT_FORMAT_PNG || format == COG_SCREENSHOT_FORMAT_RAW);
+
+    g_autoptr(GTask) task = g_task_new(self, cancellable, callback, userdata);
+    g_task_set_source_tag(task, cog_view_save_screenshot_async);
+
+    CogViewClass *klass = COG_VIEW_GET_CLASS(self);
+    if (!klass->capture_frame) {
+        g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Capturing frames is not supported");
+        return;
+    }
+
+    ScreenshotData *data = g_new0(ScreenshotData, 1);
+    data->pixels = (*klass->capture_frame)(self, &data->width, &data->height, &data->stride);
+    data->format = format;
+    data->stream = g_object_ref(stream);
+    g_task_set_task_data(task, data, (GDestroyNotify) screenshot_data_free);
+
+    if (!data->pixels) {
+        g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_FAILED, "No frame has been rendered yet");
+        return;
+    }
+
+    g_task_run_in_thread(task, (GTaskThreadFunc) screenshot_thread);
+}
+
+/**
+ * cog_view_save_screenshot_finish:
+ * @self: A view.
+ * @result: Result passed to the callback.
+ * @error: Location where to store an error.
+ *
+ * Finishes an operation started with [method@CogView.save_screenshot_async].
+ *
+ * Returns: Whether the screenshot was written successfully.
+ *
+ * Since: 0.20
+ */
+gboolean
+cog_view_save_screenshot_finish(CogView *self, GAsyncResult *result, GError **error)
+{
+    g_return_val_if_fail(COG_IS_VIEW(self), FALSE);
+    g_return_val_if_fail(g_task_is_valid(result, self), FALSE);
+
+    return g_task_propagate_boolean(G_TASK(result), error);
+}
@@ -33,8 +33,24 @@ struct _CogViewClass {
     WebKitWebViewBackend *(*create_backend)(CogView *self);
     gboolean (*set_fullscreen)(CogView *self, gboolean enable);
     gboolean (*is_fullscreen)(CogView *self);
+    GBytes *(*capture_frame)(CogView *self, unsigned *width, unsigned *height, unsigned *stride);
 };
 
+/**
+ * CogScreenshotFormat:
+ * @COG_SCREENSHOT_FORMAT_PNG: PNG image, 8 bits per channel RGBA.
+ * @COG_SCREENSHOT_FORMAT_RAW: Tightly packed rows of native-endian 32-bit
+ *    ARGB pixels (BGRA byte order on little-endian), premultiplied alpha.
+ *
+ * Output formats for [method@CogView.save_screenshot_async].
+ *
+ * Since: 0.20
+ */
+typedef enum {
+    COG_SCREENSHOT_FORMAT_PNG,
+    COG_SCREENSHOT_FORMAT_RAW,
+} CogScreenshotFormat;
+
 #define COG_TYPE_VIEW_IMPL (cog_view_get_impl_type())
 
 COG_API
@@ -67,4 +83,12 @@ gboolean cog_view_set_visible(CogView *self);
 COG_API gboolean cog_view_set_fullscreen(CogView *self, gboolean enable);
 COG_API gboolean cog_view_is_fullscreen(CogView *self);
 
+COG_API void     cog_view_save_screenshot_async(CogView            *self,
+                                                GOutputStream      *stream,
+                                                CogScreenshotFormat format,
+                                                GCancellable       *cancellable,
+                                                GAsyncReadyCallback callback,
+                                                void               *userdata);
+COG_API gboolean cog_view_save_screenshot_finish(CogView *self, GAsyncResult *result, GError **error);
+
 G_END_DECLS
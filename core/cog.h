@@ -12,6 +12,7 @@
 
 #define COG_INSIDE_COG__ 1
 
+#include "cog-archive-handler.h"
 #include "cog-config.h"
 #include "cog-directory-files-handler.h"
 #include "cog-gamepad.h"
@@ -19,7 +20,9 @@
 #include "cog-modules.h"
 #include "cog-platform.h"
 #include "cog-prefix-routes-handler.h"
+#include "cog-proxy-handler.h"
 #include "cog-request-handler.h"
+#include "cog-resource-handler.h"
 #include "cog-shell.h"
 #include "cog-utils.h"
 #include "cog-view.h"
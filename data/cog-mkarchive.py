@@ -0,0 +1,58 @@
+#! /usr/bin/env python3
+#
+# Creates archive files which can be served using CogArchiveHandler,
+# e.g. with the "cog --archive-handler=SCHEME:PATH" command line option.
+# See the documentation of CogArchiveHandler for a description of the format.
+#
+# SPDX-License-Identifier: MIT
+
+import mimetypes
+import os
+import struct
+import sys
+
+MAGIC = b"CogPack\0"
+VERSION = 1
+HEADER = struct.Struct("<8sII")
+ENTRY = struct.Struct("<QQIIII")
+ALIGNMENT = 8
+
+if len(sys.argv) != 3:
+    raise SystemExit(f"Usage: {sys.argv[0]} directory output")
+
+root = sys.argv[1]
+files = []
+for dirpath, dirnames, filenames in os.walk(root):
+    dirnames.sort()
+    for name in filenames:
+        path = os.path.join(dirpath, name)
+        if os.path.isfile(path):
+            files.append((os.path.relpath(path, root).replace(os.sep, "/").encode("utf-8"), path))
+files.sort()
+
+strings = bytearray()
+string_offset = HEADER.size + ENTRY.size * len(files)
+string_ref = []
+for relpath, path in files:
+    mime_type = (mimetypes.guess_type(path)[0] or "").encode("utf-8")
+    string_ref.append((string_offset + len(strings), len(relpath), string_offset + len(strings) + len(relpath),
+                       len(mime_type)))
+    strings += relpath + mime_type
+
+data_offset = string_offset + len(strings)
+data_offset += -data_offset % ALIGNMENT
+
+with open(sys.argv[2], "wb") as out:
+    out.write(HEADER.pack(MAGIC, VERSION, len(files)))
+    offset = data_offset
+    for (relpath, path), refs in zip(files, string_ref):
+        size = os.path.getsize(path)
+        out.write(ENTRY.pack(offset, size, *refs))
+        offset += size + (-size % ALIGNMENT)
+    out.write(strings)
+    out.write(b"\0" * (data_offset - string_offset - len(strings)))
+    for relpath, path in files:
+        with open(path, "rb") as inp:
+            contents = inp.read()
+        out.write(contents)
+        out.write(b"\0" * (-len(contents) % ALIGNMENT))
@@ -38,6 +38,13 @@ static struct {
         GStrv       dir_handlers;
         GHashTable *handler_map;
     };
+    gint64   dir_handler_cache_size;
+    gboolean dir_handler_precompressed;
+    gint     dir_handler_resolve_ttl;
+    gint64   dir_handler_small_file_size;
+    GStrv    archive_handlers;
+    GStrv    resource_handlers;
+    GStrv    proxy_handlers;
     GStrv arguments;
     char *background_color;
     char *platform_params;
@@ -175,6 +182,80 @@ on_action_open(G_GNUC_UNUSED GAction *action, GVariant *param, CogLauncher *laun
     webkit_web_view_load_uri(cog_launcher_get_visible_view(launcher), g_variant_get_string(param, NULL));
 }
 
+typedef struct {
+    CogView            *view;
+    CogScreenshotFormat format;
+} ScreenshotRequest;
+
+static void
+on_screenshot_saved(CogView *view, GAsyncResult *result, GOutputStream *stream)
+{
+    g_autoptr(GError)       error = NULL;
+    g_autoptr(GCancellable) cancellable = NULL;
+    if (!cog_view_save_screenshot_finish(view, result, &error)) {
+        g_warning("Cannot save screenshot: %s", error->message);
+        /*
+         * Closing the stream commits the replacement of the file, which
+         * would leave a truncated one behind. Closing with a cancelled
+         * cancellable keeps the original file instead.
+         */
+        cancellable = g_cancellable_new();
+        g_cancellable_cancel(cancellable);
+    }
+
+    g_output_stream_close_async(stream, G_PRIORITY_DEFAULT, cancellable, NULL, NULL);
+    g_object_unref(stream);
+}
+
+static void
+on_screenshot_file_replaced(GFile *file, GAsyncResult *result, ScreenshotRequest *request)
+{
+    g_autoptr(GError)            error = NULL;
+    g_autoptr(GFileOutputStream) stream = g_file_replace_finish(file, result, &error);
+    if (stream) {
+        cog_view_save_screenshot_async(request->view, G_OUTPUT_STREAM(stream), request->format, NULL,
+                                       (GAsyncReadyCallback) on_screenshot_saved, g_object_ref(stream));
+    } else {
+        g_warning("Cannot save screenshot: %s", error->message);
+    }
+
+    g_object_unref(request->view);
+    g_free(request);
+}
+
+static void
+on_action_screenshot(G_GNUC_UNUSED GAction *action, GVariant *param, CogLauncher *launcher)
+{
+    g_return_if_fail(g_variant_is_of_type(param, G_VARIANT_TYPE("(ss)")));
+
+    const char *path, *format_name;
+    g_variant_get(param, "(&s&s)", &path, &format_name);
+
+    CogScreenshotFormat format;
+    if (g_strcmp0(format_name, "png") == 0) {
+        format = COG_SCREENSHOT_FORMAT_PNG;
+    } else if (g_strcmp0(format_name, "raw") == 0) {
+        format = COG_SCREENSHOT_FORMAT_RAW;
+    } else {
+        g_warning("Invalid screenshot format '%s'", format_name);
+        return;
+    }
+
+    WebKitWebView *view = cog_launcher_get_visible_view(launcher);
+    if (!view) {
+        g_warning("Cannot save screenshot: No web view");
+        return;
+    }
+
+    ScreenshotRequest *request = g_new0(ScreenshotRequest, 1);
+    request->view = g_object_ref(COG_VIEW(view));
+    request->format = format;
+
+    g_autoptr(GFile) file = g_file_new_for_path(path);
+    g_file_replace_async(file, NULL, FALSE, G_FILE_CREATE_REPLACE_DESTINATION, G_PRIORITY_DEFAULT, NULL,
+                         (GAsyncReadyCallback) on_screenshot_file_replaced, request);
+}
+
 static gboolean
 on_signal_quit(CogLauncher *launcher)
 {
@@ -1198,6 +1279,20 @@ static GOptionEntry s_cli_options[] = {
      NULL},
     {"dir-handler", 'd', 0, G_OPTION_ARG_STRING_ARRAY, &s_options.dir_handlers,
      "Add a URI scheme handler for a directory", "SCHEME:PATH"},
+    {"dir-handler-cache-size", '\0', 0, G_OPTION_ARG_INT64, &s_options.dir_handler_cache_size,
+     "Memory used to cache files served by directory handlers (default: 0, disabled).", "BYTES"},
+    {"dir-handler-precompressed", '\0', 0, G_OPTION_ARG_NONE, &s_options.dir_handler_precompressed,
+     "Serve files from directory handlers using their gzip-compressed .gz version when available.", NULL},
+    {"dir-handler-resolve-ttl", '\0', 0, G_OPTION_ARG_INT, &s_options.dir_handler_resolve_ttl,
+     "Time to remember directories and missing files in directory handlers (default: 0, disabled).", "MSEC"},
+    {"dir-handler-small-file-size", '\0', 0, G_OPTION_ARG_INT64, &s_options.dir_handler_small_file_size,
+     "Read files up to this size in a single operation in directory handlers (default: 0, disabled).", "BYTES"},
+    {"archive-handler", '\0', 0, G_OPTION_ARG_STRING_ARRAY, &s_options.archive_handlers,
+     "Add a URI scheme handler for an archive file", "SCHEME:PATH"},
+    {"resource-handler", '\0', 0, G_OPTION_ARG_STRING_ARRAY, &s_options.resource_handlers,
+     "Add a URI scheme handler for a GResource bundle file, or for a resource:///PREFIX in the program", "SCHEME:PATH"},
+    {"proxy-handler", '\0', 0, G_OPTION_ARG_STRING_ARRAY, &s_options.proxy_handlers,
+     "Add a URI scheme handler forwarding requests to an HTTP server on a UNIX socket", "SCHEME:PATH"},
     {"webprocess-failure", '\0', 0, G_OPTION_ARG_STRING, &s_options.on_failure.action_name,
      "Action on WebProcess failures: error-page (default), exit, exit-ok, restart.", "ACTION"},
     {"config", 'C', 0, G_OPTION_ARG_FILENAME, &s_options.config_file, "Path to a configuration file", "PATH"},
@@ -1256,6 +1351,7 @@ cog_launcher_constructed(GObject *object)
     cog_launcher_add_action(launcher, "next", on_action_next, NULL);
     cog_launcher_add_action(launcher, "reload", on_action_reload, NULL);
     cog_launcher_add_action(launcher, "open", on_action_open, G_VARIANT_TYPE_STRING);
+    cog_launcher_add_action(launcher, "screenshot", on_action_screenshot, G_VARIANT_TYPE("(ss)"));
 
     g_application_add_main_option_entries(G_APPLICATION(object), s_cli_options);
     cog_launcher_add_web_settings_option_entries(launcher);
@@ -1317,6 +1413,36 @@ load_settings(WebKitSettings *settings, GKeyFile *key_file, GError **error)
     return TRUE;
 }
 
+/*
+ * Splits a "SCHEME:PATH" URI handler specification in place, by replacing
+ * the colon with a NUL character. Prints an error and returns FALSE if the
+ * specification is malformed.
+ */
+static gboolean
+parse_handler_spec(char *spec, const char **scheme, const char **path)
+{
+    char *colon = strchr(spec, ':');
+    if (!colon) {
+        g_printerr("%s: Invalid URI handler specification '%s'\n", g_get_prgname(), spec);
+        return FALSE;
+    }
+
+    if (spec == colon) {
+        g_printerr("%s: No scheme specified for '%s' URI handler\n", g_get_prgname(), spec);
+        return FALSE;
+    }
+
+    if (colon[1] == '\0') {
+        g_printerr("%s: Empty path specified for '%s' URI handler\n", g_get_prgname(), spec);
+        return FALSE;
+    }
+
+    *colon = '\0'; /* NULL-terminate the URI scheme name. */
+    *scheme = spec;
+    *path = colon + 1;
+    return TRUE;
+}
+
 static int
 cog_launcher_handle_local_options(GApplication *application, GVariantDict *options)
 {
@@ -1381,34 +1507,93 @@ cog_launcher_handle_local_options(GApplication *application, GVariantDict *optio
      */
     g_autoptr(GHashTable) handler_map = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
     for (size_t i = 0; s_options.dir_handlers && s_options.dir_handlers[i]; i++) {
-        char *colon = strchr(s_options.dir_handlers[i], ':');
-        if (!colon) {
-            g_printerr("%s: Invalid URI handler specification '%s'\n", g_get_prgname(), s_options.dir_handlers[i]);
+        const char *scheme, *path;
+        if (!parse_handler_spec(s_options.dir_handlers[i], &scheme, &path))
             return EXIT_FAILURE;
-        }
 
-        if (s_options.dir_handlers[i] == colon - 1) {
-            g_printerr("%s: No scheme specified for '%s' URI handler\n", g_get_prgname(), s_options.dir_handlers[i]);
+        g_autoptr(GFile) file = g_file_new_for_commandline_arg(path);
+
+        g_autoptr(GError) error = NULL;
+        if (!cog_directory_files_handler_is_suitable_path(file, &error)) {
+            g_printerr("%s: %s\n", g_get_prgname(), error->message);
             return EXIT_FAILURE;
         }
 
-        if (colon[1] == '\0') {
-            g_printerr("%s: Empty path specified for '%s' URI handler\n", g_get_prgname(), s_options.dir_handlers[i]);
+        CogRequestHandler *handler = cog_directory_files_handler_new(file);
+        if (s_options.dir_handler_cache_size > 0)
+            cog_directory_files_handler_set_cache_size(COG_DIRECTORY_FILES_HANDLER(handler),
+                                                       s_options.dir_handler_cache_size);
+        cog_directory_files_handler_set_precompressed(COG_DIRECTORY_FILES_HANDLER(handler),
+                                                      s_options.dir_handler_precompressed);
+        if (s_options.dir_handler_resolve_ttl > 0)
+            cog_directory_files_handler_set_resolve_ttl(COG_DIRECTORY_FILES_HANDLER(handler),
+                                                        s_options.dir_handler_resolve_ttl);
+        if (s_options.dir_handler_small_file_size > 0)
+            cog_directory_files_handler_set_small_file_size(COG_DIRECTORY_FILES_HANDLER(handler),
+                                                            s_options.dir_handler_small_file_size);
+
+        g_hash_table_insert(handler_map, g_strdup(scheme), handler);
+    }
+    g_clear_pointer(&s_options.dir_handlers, g_strfreev);
+
+    for (size_t i = 0; s_options.archive_handlers && s_options.archive_handlers[i]; i++) {
+        const char *scheme, *path;
+        if (!parse_handler_spec(s_options.archive_handlers[i], &scheme, &path))
             return EXIT_FAILURE;
-        }
 
-        g_autoptr(GFile) file = g_file_new_for_commandline_arg(colon + 1);
+        g_autoptr(GFile) file = g_file_new_for_commandline_arg(path);
 
         g_autoptr(GError) error = NULL;
-        if (!cog_directory_files_handler_is_suitable_path(file, &error)) {
+        CogRequestHandler *handler = cog_archive_handler_new(file, &error);
+        if (!handler) {
             g_printerr("%s: %s\n", g_get_prgname(), error->message);
             return EXIT_FAILURE;
         }
 
-        *colon = '\0'; /* NULL-terminate the URI scheme name. */
-        g_hash_table_insert(handler_map, g_strdup(s_options.dir_handlers[i]), cog_directory_files_handler_new(file));
+        g_hash_table_insert(handler_map, g_strdup(scheme), handler);
     }
-    g_clear_pointer(&s_options.dir_handlers, g_strfreev);
+    g_clear_pointer(&s_options.archive_handlers, g_strfreev);
+
+    for (size_t i = 0; s_options.resource_handlers && s_options.resource_handlers[i]; i++) {
+        const char *scheme, *path;
+        if (!parse_handler_spec(s_options.resource_handlers[i], &scheme, &path))
+            return EXIT_FAILURE;
+
+        CogRequestHandler *handler;
+        if (g_str_has_prefix(path, "resource://")) {
+            /* Resources compiled into the program, under a prefix. */
+            const char *base_path = path + strlen("resource://");
+            if (base_path[0] != '\0' && base_path[0] != '/') {
+                g_printerr("%s: Invalid resource path specified for '%s' URI handler\n", g_get_prgname(), scheme);
+                return EXIT_FAILURE;
+            }
+            handler = cog_resource_handler_new(NULL, base_path[0] ? base_path : NULL);
+        } else {
+            g_autoptr(GFile) file = g_file_new_for_commandline_arg(path);
+            g_autofree char *file_path = g_file_get_path(file);
+
+            g_autoptr(GError) error = NULL;
+            g_autoptr(GResource) resource = g_resource_load(file_path ? file_path : path, &error);
+            if (!resource) {
+                g_printerr("%s: Cannot load resources from '%s': %s\n", g_get_prgname(), path, error->message);
+                return EXIT_FAILURE;
+            }
+            handler = cog_resource_handler_new(resource, NULL);
+        }
+
+        g_hash_table_insert(handler_map, g_strdup(scheme), handler);
+    }
+    g_clear_pointer(&s_options.resource_handlers, g_strfreev);
+
+    for (size_t i = 0; s_options.proxy_handlers && s_options.proxy_handlers[i]; i++) {
+        const char *scheme, *path;
+        if (!parse_handler_spec(s_options.proxy_handlers[i], &scheme, &path))
+            return EXIT_FAILURE;
+
+        CogRequestHandler *handler = cog_proxy_handler_new(path);
+        g_hash_table_insert(handler_map, g_strdup(scheme), handler);
+    }
+    g_clear_pointer(&s_options.proxy_handlers, g_strfreev);
     s_options.handler_map = g_hash_table_size(handler_map) ? g_steal_pointer(&handler_map) : NULL;
 
     s_options.home_uri = g_steal_pointer(&utf8_uri);
@@ -188,6 +188,53 @@ cmd_open (const char               *name,
 }
 
 
+static int
+cmd_screenshot (const char               *name,
+                G_GNUC_UNUSED const void *data,
+                int                       argc,
+                char                    **argv)
+{
+    gboolean raw = FALSE;
+    GOptionEntry entries[] = {
+        { "raw", 'r', 0, G_OPTION_ARG_NONE, &raw,
+            "Write raw BGRA pixels instead of a PNG image",
+            NULL },
+        { NULL, }
+    };
+
+    g_autoptr(GOptionContext) option_context =
+        g_option_context_new ("screenshot PATH");
+    g_option_context_set_description (option_context,
+                                      cmd_find_by_name (name)->desc);
+    g_option_context_add_main_entries (option_context, entries, NULL);
+
+    g_autoptr(GError) error = NULL;
+    if (!g_option_context_parse (option_context, &argc, &argv, &error) || argc != 2) {
+        g_printerr ("%s: %s\n", name, error ? error->message : "Missing output path");
+        return EXIT_FAILURE;
+    }
+
+    /* Paths are resolved by Cog, which may have a different working directory. */
+    g_autoptr(GFile) file = g_file_new_for_commandline_arg (argv[1]);
+    g_autofree char *path = g_file_get_path (file);
+    if (!path) {
+        g_printerr ("%s: Invalid output path '%s'\n", name, argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    g_autoptr(GVariantBuilder) param =
+        g_variant_builder_new (G_VARIANT_TYPE ("av"));
+    g_variant_builder_add (param, "v", g_variant_new ("(ss)", path, raw ? "raw" : "png"));
+    GVariant *params = g_variant_new ("(sava{sv})", "screenshot", param, NULL);
+
+    if (!call_method (GTK_ACTIONS_ACTIVATE, params, &error)) {
+        g_printerr ("%s\n", error->message);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+
 static int
 cmd_ping (const char               *name,
           G_GNUC_UNUSED const void *data,
@@ -304,6 +351,11 @@ cmd_find_by_name (const char *name)
             .desc = "Reload the current page",
             .handler = cmd_generic_no_args,
         },
+        {
+            .name = "screenshot",
+            .desc = "Save the last rendered frame to a file",
+            .handler = cmd_screenshot,
+        },
         {
             .name = NULL,
         },
@@ -31,14 +31,6 @@ typedef struct {
     struct gbm_bo      *next_bo;
     uint32_t            gbm_format;
 
-    /*
-     * Logical view size without transformations applied, which is needed to
-     * change the transformed size (i.e. rotated) of the view after the view
-     * backend has been instantiated. Note that physical output size is
-     * always determinted from the chosen DRM/KMS mode.
-     */
-    uint32_t width, height;
-
     CogGLRendererRotation rotation;
 
     EGLDisplay egl_display;
@@ -48,7 +40,7 @@ typedef struct {
 
     CogGLRenderer gl_render;
 
-    struct wpe_view_backend_exportable_fdo *exportable;
+    CogDrmExportable *frame_complete_source; /* Of the frame waiting for the page flip. */
 
     drmEventContext drm_context;
     unsigned        drm_fd_source;
@@ -68,7 +60,16 @@ typedef struct {
 static void
 cog_drm_gles_renderer_handle_egl_image(void *data, struct wpe_fdo_egl_exported_image *image)
 {
-    CogDrmGlesRenderer *self = data;
+    CogDrmExportable *source = data;
+
+    /* The view is not shown in any output. */
+    if (!source->renderer) {
+        wpe_view_backend_exportable_fdo_egl_dispatch_release_exported_image(source->exportable, image);
+        source->frame_complete_pending = true;
+        return;
+    }
+
+    CogDrmGlesRenderer *self = wl_container_of(source->renderer, self, base);
 
     if (!eglMakeCurrent(self->egl_display, self->egl_surface, self->egl_surface, self->egl_context)) {
         g_critical("%s: Cannot activate EGL context for rendering (%#04x)", __func__, eglGetError());
@@ -86,7 +87,7 @@ cog_drm_gles_renderer_handle_egl_image(void *data, struct wpe_fdo_egl_exported_i
         return;
     }
 
-    wpe_view_backend_exportable_fdo_egl_dispatch_release_exported_image(self->exportable, image);
+    wpe_view_backend_exportable_fdo_egl_dispatch_release_exported_image(source->exportable, image);
 
     int drm_fd = gbm_device_get_fd(self->gbm_device);
 
@@ -145,6 +146,11 @@ cog_drm_gles_renderer_handle_egl_image(void *data, struct wpe_fdo_egl_exported_i
         g_warning("%s: Cannot schedule page flip (%s)", __func__, g_strerror(errno));
         return;
     }
+
+    /* A view which stopped being shown before the flip gets notified now. */
+    if (self->frame_complete_source && self->frame_complete_source != source)
+        wpe_view_backend_exportable_fdo_dispatch_frame_complete(self->frame_complete_source->exportable);
+    self->frame_complete_source = source;
 }
 
 static void
@@ -159,7 +165,9 @@ cog_drm_gles_renderer_handle_page_flip(int fd, unsigned frame, unsigned sec, uns
     }
     self->current_bo = g_steal_pointer(&self->next_bo);
 
-    wpe_view_backend_exportable_fdo_dispatch_frame_complete(self->exportable);
+    CogDrmExportable *source = g_steal_pointer(&self->frame_complete_source);
+    if (source)
+        wpe_view_backend_exportable_fdo_dispatch_frame_complete(source->exportable);
 }
 
 static gboolean
@@ -333,25 +341,6 @@ cog_drm_gles_renderer_destroy(CogDrmRenderer *renderer)
     }
 }
 
-static void
-cog_drm_gles_renderer_transformed_logical_size(const CogDrmGlesRenderer *self, uint32_t *width, uint32_t *height)
-{
-    switch (self->rotation) {
-    case COG_GL_RENDERER_ROTATION_0:
-    case COG_GL_RENDERER_ROTATION_180:
-        *width = self->width;
-        *height = self->height;
-        break;
-    case COG_GL_RENDERER_ROTATION_90:
-    case COG_GL_RENDERER_ROTATION_270:
-        *width = self->height;
-        *height = self->width;
-        break;
-    default:
-        g_assert_not_reached();
-    }
-}
-
 static bool
 cog_drm_gles_renderer_set_rotation(CogDrmRenderer *renderer, CogGLRendererRotation rotation, bool apply)
 {
@@ -361,34 +350,33 @@ cog_drm_gles_renderer_set_rotation(CogDrmRenderer *renderer, CogGLRendererRotati
     if (!apply)
         return supported;
 
+    /* The platform takes care of resizing the views shown in the output. */
     CogDrmGlesRenderer *self = wl_container_of(renderer, self, base);
-    if (self->rotation == rotation)
-        return true;
-
     self->rotation = rotation;
-
-    if (self->exportable) {
-        uint32_t width, height;
-        cog_drm_gles_renderer_transformed_logical_size(self, &width, &height);
-        wpe_view_backend_dispatch_set_size(wpe_view_backend_exportable_fdo_get_view_backend(self->exportable), width,
-                                           height);
-    }
     return true;
 }
 
 static struct wpe_view_backend_exportable_fdo *
-cog_drm_gles_renderer_create_exportable(CogDrmRenderer *renderer, uint32_t width, uint32_t height)
+cog_drm_gles_renderer_create_exportable(CogDrmRenderer   *renderer G_GNUC_UNUSED,
+                                        CogDrmExportable *exportable,
+                                        uint32_t          width,
+                                        uint32_t          height)
 {
-    CogDrmGlesRenderer *self = wl_container_of(renderer, self, base);
-
-    self->width = width;
-    self->height = height;
-    cog_drm_gles_renderer_transformed_logical_size(self, &width, &height);
-
     static const struct wpe_view_backend_exportable_fdo_egl_client client = {
         .export_fdo_egl_image = cog_drm_gles_renderer_handle_egl_image,
     };
-    return (self->exportable = wpe_view_backend_exportable_fdo_egl_create(&client, renderer, width, height));
+    return wpe_view_backend_exportable_fdo_egl_create(&client, exportable, width, height);
+}
+
+static void
+cog_drm_gles_renderer_drop_exportable(CogDrmRenderer *renderer, CogDrmExportable *exportable)
+{
+    /* Images are released once painted, only frame completion may be pending. */
+    CogDrmGlesRenderer *self = wl_container_of(renderer, self, base);
+    if (self->frame_complete_source == exportable) {
+        self->frame_complete_source = NULL;
+        exportable->frame_complete_pending = true;
+    }
 }
 
 CogDrmRenderer *
@@ -410,6 +398,7 @@ cog_drm_gles_renderer_new(struct gbm_device     *gbm_device,
         .base.destroy = cog_drm_gles_renderer_destroy,
         .base.set_rotation = cog_drm_gles_renderer_set_rotation,
         .base.create_exportable = cog_drm_gles_renderer_create_exportable,
+        .base.drop_exportable = cog_drm_gles_renderer_drop_exportable,
 
         .rotation = COG_GL_RENDERER_ROTATION_0,
 
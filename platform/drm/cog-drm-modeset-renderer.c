@@ -7,6 +7,7 @@
 
 #include "../../core/cog.h"
 #include "cog-drm-renderer.h"
+#include "cog-drm-shm-copy.h"
 #include <errno.h>
 #include <gbm.h>
 #include <wayland-server.h>
@@ -67,29 +68,49 @@ drm_event_source_new(int fd)
     return &self->base;
 }
 
+typedef struct _CogDrmModesetRenderer CogDrmModesetRenderer;
+
 struct buffer_object {
-    struct wl_list     link;
-    struct wl_listener destroy_listener;
+    struct wl_list         link;
+    struct wl_listener     destroy_listener;
+    CogDrmModesetRenderer *renderer;
 
     uint32_t            fb_id;
     struct gbm_bo      *bo;
     struct wl_resource *buffer_resource;
 
     struct {
+        CogDrmExportable                   *source;
         struct wl_resource                 *resource;
         struct wpe_fdo_shm_exported_buffer *shm_buffer;
     } export;
+
+    /* Hashes of the rows last copied into the BO, for SHM buffers. */
+    uint64_t *row_hashes;
+    uint32_t  n_rows;
+    bool      row_hashes_valid;
 };
 
-typedef struct {
+struct _CogDrmModesetRenderer {
     CogDrmRenderer base;
 
     GSource *drm_source;
 
-    struct buffer_object *committed_buffer;
-    struct wl_list        buffer_list; /* buffer_object::link */
-
-    struct wpe_view_backend_exportable_fdo *exportable;
+    /*
+     * Buffers are presented with a mailbox policy: while a page flip is
+     * pending, the most recent frame waits in the mailbox to be committed
+     * after the flip, and a newer frame replaces it, releasing the older
+     * one back to WebKit without it ever being displayed. Frame completion
+     * is reported right away only when no flip is pending, and otherwise
+     * on the next flip, so rendering is never paced above the refresh rate.
+     */
+    struct buffer_object *committed_buffer; /* Being scanned out. */
+    struct buffer_object *flip_buffer;      /* Committed, waiting for the page flip. */
+    struct buffer_object *mailbox_buffer;   /* Waiting to be committed. */
+    bool                  flip_pending;
+    CogDrmExportable     *frame_complete_deferred; /* Source of the mailbox buffer. */
+
+    struct wl_list buffer_list; /* buffer_object::link, most recently used first. */
 
     struct gbm_device *gbm_dev;
 
@@ -100,12 +121,20 @@ typedef struct {
     bool            mode_set;
     bool            atomic_modesetting;
     bool            addfb2_modifiers;
+    bool            fb_damage_clips;
+
+    /* Row hashes of the SHM frame in the last plane update, if any. */
+    struct {
+        uint64_t *row_hashes;
+        uint32_t  n_rows;
+        bool      valid;
+    } scanout;
 
     struct {
         drmModeObjectProperties *props;
         drmModePropertyRes     **props_info;
     } connector_props, crtc_props, plane_props;
-} CogDrmModesetRenderer;
+};
 
 static inline int
 get_drm_fd(CogDrmModesetRenderer *self)
@@ -115,22 +144,32 @@ get_drm_fd(CogDrmModesetRenderer *self)
 }
 
 static void
-destroy_buffer(CogDrmModesetRenderer *renderer, struct buffer_object *buffer)
+drm_release_buffer(struct buffer_object *buffer)
 {
-    drmModeRmFB(get_drm_fd(renderer), buffer->fb_id);
-    gbm_bo_destroy(buffer->bo);
-
     if (buffer->export.resource) {
-        wpe_view_backend_exportable_fdo_dispatch_release_buffer(renderer->exportable, buffer->export.resource);
+        wpe_view_backend_exportable_fdo_dispatch_release_buffer(buffer->export.source->exportable,
+                                                                buffer->export.resource);
         buffer->export.resource = NULL;
     }
 
     if (buffer->export.shm_buffer) {
-        wpe_view_backend_exportable_fdo_dispatch_release_shm_exported_buffer(renderer->exportable,
+        wpe_view_backend_exportable_fdo_dispatch_release_shm_exported_buffer(buffer->export.source->exportable,
                                                                              buffer->export.shm_buffer);
         buffer->export.shm_buffer = NULL;
     }
 
+    buffer->export.source = NULL;
+}
+
+static void
+destroy_buffer(CogDrmModesetRenderer *renderer, struct buffer_object *buffer)
+{
+    drmModeRmFB(get_drm_fd(renderer), buffer->fb_id);
+    gbm_bo_destroy(buffer->bo);
+
+    drm_release_buffer(buffer);
+
+    g_free(buffer->row_hashes);
     g_free(buffer);
 }
 
@@ -138,14 +177,16 @@ static void
 destroy_buffer_notify(struct wl_listener *listener, void *data)
 {
     struct buffer_object  *buffer = wl_container_of(listener, buffer, destroy_listener);
-    CogDrmModesetRenderer *renderer = wl_resource_get_user_data(buffer->buffer_resource);
+    CogDrmModesetRenderer *renderer = buffer->renderer;
 
     if (renderer->committed_buffer == buffer)
         renderer->committed_buffer = NULL;
+    if (renderer->flip_buffer == buffer)
+        renderer->flip_buffer = NULL;
+    if (renderer->mailbox_buffer == buffer)
+        renderer->mailbox_buffer = NULL;
 
     wl_list_remove(&buffer->link);
-
-    wl_resource_set_user_data(buffer->buffer_resource, NULL);
     destroy_buffer(renderer, buffer);
 }
 
@@ -154,12 +195,82 @@ drm_buffer_for_resource(CogDrmModesetRenderer *renderer, struct wl_resource *buf
 {
     struct buffer_object *buffer;
     wl_list_for_each(buffer, &renderer->buffer_list, link) {
-        if (buffer->buffer_resource == buffer_resource)
+        if (buffer->buffer_resource == buffer_resource) {
+            /* Keep the list in most recently used order. */
+            wl_list_remove(&buffer->link);
+            wl_list_insert(&renderer->buffer_list, &buffer->link);
             return buffer;
+        }
     }
     return NULL;
 }
 
+/*
+ * Maximum number of buffers kept around, enough for the buffer being
+ * scanned out, the one waiting for the flip, the one in the mailbox, and
+ * those being rendered by WebKit.
+ */
+#define MAX_BUFFERS 6
+
+static inline bool
+drm_buffer_is_busy(CogDrmModesetRenderer *self, struct buffer_object *buffer)
+{
+    return buffer == self->committed_buffer || buffer == self->flip_buffer || buffer == self->mailbox_buffer ||
+           buffer->export.resource || buffer->export.shm_buffer;
+}
+
+static void
+drm_buffer_detach(struct buffer_object *buffer)
+{
+    wl_list_remove(&buffer->destroy_listener.link);
+    buffer->buffer_resource = NULL;
+}
+
+/*
+ * The same resource may be attached to buffers of several renderers, when
+ * a view is moved between outputs, so the resource user data is not used.
+ */
+static void
+drm_buffer_attach(CogDrmModesetRenderer *self, struct buffer_object *buffer, struct wl_resource *buffer_resource)
+{
+    buffer->destroy_listener.notify = destroy_buffer_notify;
+    wl_resource_add_destroy_listener(buffer_resource, &buffer->destroy_listener);
+    buffer->renderer = self;
+    buffer->buffer_resource = buffer_resource;
+}
+
+/*
+ * Returns the least recently used idle buffer once the pool is full,
+ * optionally only one which holds a copy of SHM data with the given size.
+ */
+static struct buffer_object *
+drm_buffer_pool_find_idle(CogDrmModesetRenderer *self, bool shm, uint32_t width, uint32_t height)
+{
+    if (wl_list_length(&self->buffer_list) < MAX_BUFFERS)
+        return NULL;
+
+    struct buffer_object *buffer;
+    wl_list_for_each_reverse(buffer, &self->buffer_list, link) {
+        if (drm_buffer_is_busy(self, buffer))
+            continue;
+        if (!shm || (buffer->row_hashes && buffer->n_rows == height && gbm_bo_get_width(buffer->bo) == width))
+            return buffer;
+    }
+    return NULL;
+}
+
+/* Makes room for a new buffer by destroying idle ones. */
+static void
+drm_buffer_pool_trim(CogDrmModesetRenderer *self)
+{
+    struct buffer_object *buffer;
+    while ((buffer = drm_buffer_pool_find_idle(self, false, 0, 0))) {
+        wl_list_remove(&buffer->link);
+        drm_buffer_detach(buffer);
+        destroy_buffer(self, buffer);
+    }
+}
+
 static struct buffer_object *
 drm_create_buffer_for_bo(CogDrmModesetRenderer *self,
                          struct gbm_bo         *bo,
@@ -191,6 +302,8 @@ drm_create_buffer_for_bo(CogDrmModesetRenderer *self,
         in_modifiers[i] = in_modifiers[0];
     }
 
+    drm_buffer_pool_trim(self);
+
     int      ret;
     uint32_t fb_id = 0;
 
@@ -214,13 +327,10 @@ drm_create_buffer_for_bo(CogDrmModesetRenderer *self,
 
     struct buffer_object *buffer = g_new0(struct buffer_object, 1);
     wl_list_insert(&self->buffer_list, &buffer->link);
-    buffer->destroy_listener.notify = destroy_buffer_notify;
-    wl_resource_add_destroy_listener(buffer_resource, &buffer->destroy_listener);
-    wl_resource_set_user_data(buffer_resource, self);
+    drm_buffer_attach(self, buffer, buffer_resource);
 
     buffer->fb_id = fb_id;
     buffer->bo = bo;
-    buffer->buffer_resource = buffer_resource;
 
     return buffer;
 }
@@ -239,6 +349,21 @@ drm_create_buffer_for_shm_buffer(CogDrmModesetRenderer *self,
     int32_t width = wl_shm_buffer_get_width(shm_buffer);
     int32_t height = wl_shm_buffer_get_height(shm_buffer);
 
+    /*
+     * Once the pool is full, reuse an idle BO of the same size, which avoids
+     * allocating a new one when WebKit cycles through more SHM buffers.
+     */
+    struct buffer_object *buffer = drm_buffer_pool_find_idle(self, true, width, height);
+    if (buffer) {
+        wl_list_remove(&buffer->link);
+        wl_list_insert(&self->buffer_list, &buffer->link);
+        drm_buffer_detach(buffer);
+        drm_buffer_attach(self, buffer, buffer_resource);
+        buffer->row_hashes_valid = false;
+        return buffer;
+    }
+    drm_buffer_pool_trim(self);
+
     // TODO: don't ignore the alpha channel in case of ARGB8888 SHM data
     uint32_t       gbm_format = GBM_FORMAT_XRGB8888;
     struct gbm_bo *bo = gbm_bo_create(self->gbm_dev, width, height, gbm_format, GBM_BO_USE_SCANOUT | GBM_BO_USE_WRITE);
@@ -267,60 +392,64 @@ drm_create_buffer_for_shm_buffer(CogDrmModesetRenderer *self,
         return NULL;
     }
 
-    struct buffer_object *buffer = g_new0(struct buffer_object, 1);
+    buffer = g_new0(struct buffer_object, 1);
     wl_list_insert(&self->buffer_list, &buffer->link);
-    buffer->destroy_listener.notify = destroy_buffer_notify;
-    wl_resource_add_destroy_listener(buffer_resource, &buffer->destroy_listener);
-    wl_resource_set_user_data(buffer_resource, self);
+    drm_buffer_attach(self, buffer, buffer_resource);
 
     buffer->fb_id = fb_id;
     buffer->bo = bo;
-    buffer->buffer_resource = buffer_resource;
+    buffer->n_rows = height;
+    buffer->row_hashes = g_new(uint64_t, height);
 
     return buffer;
 }
 
 static void
-drm_copy_shm_buffer_into_bo(struct wl_shm_buffer *shm_buffer, struct gbm_bo *bo)
+drm_copy_shm_buffer_into_bo(struct wl_shm_buffer *shm_buffer, struct buffer_object *buffer)
 {
-    int32_t width = wl_shm_buffer_get_width(shm_buffer);
-    int32_t height = wl_shm_buffer_get_height(shm_buffer);
-    int32_t stride = wl_shm_buffer_get_stride(shm_buffer);
+    struct gbm_bo *bo = buffer->bo;
 
+    uint32_t width = MIN((uint32_t) wl_shm_buffer_get_width(shm_buffer), gbm_bo_get_width(bo));
+    uint32_t height = MIN((uint32_t) wl_shm_buffer_get_height(shm_buffer), buffer->n_rows);
+    uint32_t stride = wl_shm_buffer_get_stride(shm_buffer);
+    if (!width || !height)
+        return;
+
+    /*
+     * The returned pointer is where data gets written, map_data is only
+     * an opaque handle to be passed back to gbm_bo_unmap(). When only some
+     * rows are to be written the mapping must also preserve the others,
+     * in case the driver maps a staging copy of the BO.
+     */
     uint32_t bo_stride = 0;
     void    *map_data = NULL;
-    gbm_bo_map(bo, 0, 0, width, height, GBM_BO_TRANSFER_WRITE, &bo_stride, &map_data);
-    if (!map_data)
+    uint8_t *dst = gbm_bo_map(bo, 0, 0, width, height,
+                              buffer->row_hashes_valid ? GBM_BO_TRANSFER_READ_WRITE : GBM_BO_TRANSFER_WRITE,
+                              &bo_stride, &map_data);
+    if (!dst) {
+        buffer->row_hashes_valid = false;
         return;
+    }
 
     wl_shm_buffer_begin_access(shm_buffer);
 
-    uint8_t *src = wl_shm_buffer_get_data(shm_buffer);
-    uint8_t *dst = map_data;
-
-    uint32_t bo_width = gbm_bo_get_width(bo);
-    uint32_t bo_height = gbm_bo_get_height(bo);
-    if (!(width == bo_width && height == bo_height && stride == bo_stride)) {
-        for (uint32_t y = 0; y < height; ++y) {
-            for (uint32_t x = 0; x < width; ++x) {
-                dst[bo_stride * y + 4 * x + 0] = src[stride * y + 4 * x + 0];
-                dst[bo_stride * y + 4 * x + 1] = src[stride * y + 4 * x + 1];
-                dst[bo_stride * y + 4 * x + 2] = src[stride * y + 4 * x + 2];
-                dst[bo_stride * y + 4 * x + 3] = src[stride * y + 4 * x + 3];
-            }
-        }
-    } else
-        memcpy(dst, src, stride * height);
+    const uint8_t *src = wl_shm_buffer_get_data(shm_buffer);
+
+    /*
+     * Both ARGB8888 and XRGB8888 have the same memory layout, and the BO is
+     * always XRGB8888, so pixels need no conversion: copy whole rows, and
+     * only those which changed since the last time this BO was written.
+     * The first time everything is copied at once if both buffers have
+     * the same stride.
+     */
+    cog_drm_copy_rows(dst, bo_stride, src, stride, (size_t) width * 4, height, buffer->row_hashes,
+                      buffer->row_hashes_valid);
+    buffer->row_hashes_valid = true;
 
     wl_shm_buffer_end_access(shm_buffer);
     gbm_bo_unmap(bo, map_data);
 }
 
-typedef struct {
-    CogDrmModesetRenderer *renderer;
-    struct buffer_object  *buffer;
-} FlipHandlerData;
-
 static int
 drm_commit_buffer_nonatomic(CogDrmModesetRenderer *self, struct buffer_object *buffer)
 {
@@ -333,10 +462,7 @@ drm_commit_buffer_nonatomic(CogDrmModesetRenderer *self, struct buffer_object *b
         self->mode_set = true;
     }
 
-    FlipHandlerData *data = g_slice_new(FlipHandlerData);
-    *data = (FlipHandlerData){self, buffer};
-
-    return drmModePageFlip(get_drm_fd(self), self->crtc_id, buffer->fb_id, DRM_MODE_PAGE_FLIP_EVENT, data);
+    return drmModePageFlip(get_drm_fd(self), self->crtc_id, buffer->fb_id, DRM_MODE_PAGE_FLIP_EVENT, self);
 }
 
 static int
@@ -383,6 +509,64 @@ add_plane_property(CogDrmModesetRenderer *self,
     return add_property(self->plane_props.props, self->plane_props.props_info, req, obj_id, name, value);
 }
 
+#define MAX_DAMAGE_CLIPS 16
+
+/*
+ * Creates a FB_DAMAGE_CLIPS blob with the rows of an SHM buffer which
+ * differ from the frame in the previous plane update, and remembers the
+ * row hashes of the buffer for the next one. Returns zero when the
+ * damage is unknown, in which case no blob is used and drivers treat
+ * the whole plane as damaged.
+ */
+static uint32_t
+drm_create_damage_blob(CogDrmModesetRenderer *self, struct buffer_object *buffer)
+{
+    if (!buffer->export.shm_buffer || !buffer->row_hashes_valid) {
+        self->scanout.valid = false;
+        return 0;
+    }
+
+    struct drm_mode_rect clips[MAX_DAMAGE_CLIPS];
+    unsigned             n_clips = 0;
+    const bool           compare = self->scanout.valid && self->scanout.n_rows == buffer->n_rows;
+
+    if (compare) {
+        const int32_t width = gbm_bo_get_width(buffer->bo);
+        for (uint32_t y = 0; y < buffer->n_rows; ++y) {
+            if (self->scanout.row_hashes[y] == buffer->row_hashes[y])
+                continue;
+
+            /* Extend the last rectangle if adjacent, or when out of them. */
+            if (n_clips > 0 && (clips[n_clips - 1].y2 == y || n_clips == MAX_DAMAGE_CLIPS)) {
+                clips[n_clips - 1].y2 = y + 1;
+            } else {
+                clips[n_clips++] = (struct drm_mode_rect){0, y, width, y + 1};
+            }
+        }
+
+        /* Nothing changed. An empty rectangle is needed, no blob means everything. */
+        if (n_clips == 0)
+            clips[n_clips++] = (struct drm_mode_rect){0, 0, 0, 0};
+    }
+
+    if (self->scanout.n_rows != buffer->n_rows) {
+        self->scanout.row_hashes = g_renew(uint64_t, self->scanout.row_hashes, buffer->n_rows);
+        self->scanout.n_rows = buffer->n_rows;
+    }
+    memcpy(self->scanout.row_hashes, buffer->row_hashes, sizeof(uint64_t) * buffer->n_rows);
+    self->scanout.valid = true;
+
+    if (!compare)
+        return 0;
+
+    uint32_t blob_id = 0;
+    if (drmModeCreatePropertyBlob(get_drm_fd(self), clips, sizeof(struct drm_mode_rect) * n_clips, &blob_id)) {
+        g_debug("%s: Cannot create damage blob: %s", G_STRFUNC, g_strerror(errno));
+        return 0;
+    }
+    return blob_id;
+}
+
 static int
 drm_commit_buffer_atomic(CogDrmModesetRenderer *self, struct buffer_object *buffer)
 {
@@ -427,16 +611,24 @@ drm_commit_buffer_atomic(CogDrmModesetRenderer *self, struct buffer_object *buff
         return -1;
     }
 
-    FlipHandlerData *data = g_slice_new(FlipHandlerData);
-    *data = (FlipHandlerData){self, buffer};
+    uint32_t damage_blob_id = 0;
+    if (self->fb_damage_clips) {
+        damage_blob_id = drm_create_damage_blob(self, buffer);
+        add_plane_property(self, req, self->plane_id, "FB_DAMAGE_CLIPS", damage_blob_id);
+    }
+
+    ret = drmModeAtomicCommit(get_drm_fd(self), req, flags, self);
+
+    /* The kernel keeps its own reference to the blob in the plane state. */
+    if (damage_blob_id)
+        drmModeDestroyPropertyBlob(get_drm_fd(self), damage_blob_id);
+
+    drmModeAtomicFree(req);
 
-    ret = drmModeAtomicCommit(get_drm_fd(self), req, flags, data);
     if (ret) {
-        drmModeAtomicFree(req);
+        self->scanout.valid = false;
         return -1;
     }
-
-    drmModeAtomicFree(req);
     return 0;
 }
 
@@ -449,18 +641,75 @@ drm_commit_buffer(CogDrmModesetRenderer *self, struct buffer_object *buffer)
     else
         ret = drm_commit_buffer_nonatomic(self, buffer);
 
-    if (ret)
+    if (ret) {
         g_warning("failed to schedule a page flip: %s", g_strerror(errno));
+        drm_release_buffer(buffer);
+        return;
+    }
+
+    self->flip_buffer = buffer;
+    self->flip_pending = true;
+}
+
+static void
+drm_present_buffer(CogDrmModesetRenderer *self, struct buffer_object *buffer)
+{
+    CogDrmExportable *source = buffer->export.source;
+
+    if (!self->flip_pending) {
+        drm_commit_buffer(self, buffer);
+        wpe_view_backend_exportable_fdo_dispatch_frame_complete(source->exportable);
+        return;
+    }
+
+    /*
+     * Only frames which WebKit produces on its own, without waiting for
+     * frame completion, can find the mailbox occupied. Drop the older one.
+     * If it came from a view which is not shown anymore, that view will not
+     * be notified on the next flip, so let it continue now.
+     */
+    if (self->mailbox_buffer)
+        drm_release_buffer(self->mailbox_buffer);
+    if (self->frame_complete_deferred && self->frame_complete_deferred != source)
+        wpe_view_backend_exportable_fdo_dispatch_frame_complete(self->frame_complete_deferred->exportable);
+
+    self->mailbox_buffer = buffer;
+    self->frame_complete_deferred = source;
+}
+
+/*
+ * Frames from views which are not shown in any output are released right
+ * away. Returns the renderer for the view otherwise.
+ */
+static CogDrmModesetRenderer *
+drm_renderer_for_source(CogDrmExportable *source, struct wl_resource *resource, struct wpe_fdo_shm_exported_buffer *shm)
+{
+    if (source->renderer) {
+        CogDrmModesetRenderer *self = wl_container_of(source->renderer, self, base);
+        return self;
+    }
+
+    if (resource)
+        wpe_view_backend_exportable_fdo_dispatch_release_buffer(source->exportable, resource);
+    if (shm)
+        wpe_view_backend_exportable_fdo_dispatch_release_shm_exported_buffer(source->exportable, shm);
+    source->frame_complete_pending = true;
+    return NULL;
 }
 
 static void
 on_export_buffer_resource(void *data, struct wl_resource *buffer_resource)
 {
-    CogDrmModesetRenderer *self = data;
-    struct buffer_object  *buffer = drm_buffer_for_resource(self, buffer_resource);
+    CogDrmExportable      *source = data;
+    CogDrmModesetRenderer *self = drm_renderer_for_source(source, buffer_resource, NULL);
+    if (!self)
+        return;
+
+    struct buffer_object *buffer = drm_buffer_for_resource(self, buffer_resource);
     if (buffer) {
+        buffer->export.source = source;
         buffer->export.resource = buffer_resource;
-        drm_commit_buffer(self, buffer);
+        drm_present_buffer(self, buffer);
         return;
     }
 
@@ -477,20 +726,25 @@ on_export_buffer_resource(void *data, struct wl_resource *buffer_resource)
 
     buffer = drm_create_buffer_for_bo(self, bo, buffer_resource, width, height, format);
     if (buffer) {
+        buffer->export.source = source;
         buffer->export.resource = buffer_resource;
-        drm_commit_buffer(self, buffer);
+        drm_present_buffer(self, buffer);
     }
 }
 
 static void
 on_export_dmabuf_resource(void *data, struct wpe_view_backend_exportable_fdo_dmabuf_resource *dmabuf_resource)
 {
-    CogDrmModesetRenderer *self = data;
+    CogDrmExportable      *source = data;
+    CogDrmModesetRenderer *self = drm_renderer_for_source(source, dmabuf_resource->buffer_resource, NULL);
+    if (!self)
+        return;
 
     struct buffer_object *buffer = drm_buffer_for_resource(self, dmabuf_resource->buffer_resource);
     if (buffer) {
+        buffer->export.source = source;
         buffer->export.resource = dmabuf_resource->buffer_resource;
-        drm_commit_buffer(self, buffer);
+        drm_present_buffer(self, buffer);
         return;
     }
 
@@ -517,61 +771,61 @@ on_export_dmabuf_resource(void *data, struct wpe_view_backend_exportable_fdo_dma
     buffer = drm_create_buffer_for_bo(self, bo, dmabuf_resource->buffer_resource, dmabuf_resource->width,
                                       dmabuf_resource->height, dmabuf_resource->format);
     if (buffer) {
+        buffer->export.source = source;
         buffer->export.resource = dmabuf_resource->buffer_resource;
-        drm_commit_buffer(self, buffer);
+        drm_present_buffer(self, buffer);
     }
 }
 
 static void
 on_export_shm_buffer(void *data, struct wpe_fdo_shm_exported_buffer *exported_buffer)
 {
-    CogDrmModesetRenderer *self = data;
+    CogDrmExportable      *source = data;
+    CogDrmModesetRenderer *self = drm_renderer_for_source(source, NULL, exported_buffer);
+    if (!self)
+        return;
 
     struct wl_resource   *exported_resource = wpe_fdo_shm_exported_buffer_get_resource(exported_buffer);
     struct wl_shm_buffer *exported_shm_buffer = wpe_fdo_shm_exported_buffer_get_shm_buffer(exported_buffer);
 
     struct buffer_object *buffer = drm_buffer_for_resource(self, exported_resource);
     if (buffer) {
-        drm_copy_shm_buffer_into_bo(exported_shm_buffer, buffer->bo);
+        drm_copy_shm_buffer_into_bo(exported_shm_buffer, buffer);
 
+        buffer->export.source = source;
         buffer->export.shm_buffer = exported_buffer;
-        drm_commit_buffer(self, buffer);
+        drm_present_buffer(self, buffer);
         return;
     }
 
     buffer = drm_create_buffer_for_shm_buffer(self, exported_resource, exported_shm_buffer);
     if (buffer) {
-        drm_copy_shm_buffer_into_bo(exported_shm_buffer, buffer->bo);
+        drm_copy_shm_buffer_into_bo(exported_shm_buffer, buffer);
 
+        buffer->export.source = source;
         buffer->export.shm_buffer = exported_buffer;
-        drm_commit_buffer(self, buffer);
+        drm_present_buffer(self, buffer);
     }
 }
 
 static void
 drm_page_flip_handler(int fd, unsigned int frame, unsigned int sec, unsigned int usec, void *data)
 {
-    CogDrmModesetRenderer *self = ((FlipHandlerData *) data)->renderer;
-    struct buffer_object  *buffer = ((FlipHandlerData *) data)->buffer;
-    g_slice_free(FlipHandlerData, data);
+    CogDrmModesetRenderer *self = data;
 
-    if (self->committed_buffer) {
-        struct buffer_object *buffer = self->committed_buffer;
+    if (self->committed_buffer && self->committed_buffer != self->flip_buffer)
+        drm_release_buffer(self->committed_buffer);
 
-        if (buffer->export.resource) {
-            wpe_view_backend_exportable_fdo_dispatch_release_buffer(self->exportable, buffer->export.resource);
-            buffer->export.resource = NULL;
-        }
+    self->committed_buffer = g_steal_pointer(&self->flip_buffer);
+    self->flip_pending = false;
 
-        if (buffer->export.shm_buffer) {
-            wpe_view_backend_exportable_fdo_dispatch_release_shm_exported_buffer(self->exportable,
-                                                                                 buffer->export.shm_buffer);
-            buffer->export.shm_buffer = NULL;
-        }
-    }
+    struct buffer_object *buffer = g_steal_pointer(&self->mailbox_buffer);
+    if (buffer)
+        drm_commit_buffer(self, buffer);
 
-    self->committed_buffer = buffer;
-    wpe_view_backend_exportable_fdo_dispatch_frame_complete(self->exportable);
+    CogDrmExportable *source = g_steal_pointer(&self->frame_complete_deferred);
+    if (source)
+        wpe_view_backend_exportable_fdo_dispatch_frame_complete(source->exportable);
 }
 
 static bool
@@ -596,7 +850,7 @@ cog_drm_modeset_renderer_destroy(CogDrmRenderer *renderer)
         destroy_buffer(self, buffer);
     }
     wl_list_init(&self->buffer_list);
-    self->committed_buffer = NULL;
+    self->committed_buffer = self->flip_buffer = self->mailbox_buffer = NULL;
 
     if (self->connector_props.props_info) {
         for (uint32_t i = 0; i < self->connector_props.props->count_props; i++)
@@ -619,13 +873,17 @@ cog_drm_modeset_renderer_destroy(CogDrmRenderer *renderer)
     g_clear_pointer(&self->plane_props.props, drmModeFreeObjectProperties);
     g_clear_pointer(&self->plane_props.props_info, g_free);
 
+    g_clear_pointer(&self->scanout.row_hashes, g_free);
     g_clear_pointer(&self->gbm_dev, gbm_device_destroy);
 
     g_slice_free(CogDrmModesetRenderer, self);
 }
 
 static struct wpe_view_backend_exportable_fdo *
-cog_drm_modeset_renderer_create_exportable(CogDrmRenderer *renderer, uint32_t width, uint32_t height)
+cog_drm_modeset_renderer_create_exportable(CogDrmRenderer   *renderer G_GNUC_UNUSED,
+                                           CogDrmExportable *exportable,
+                                           uint32_t          width,
+                                           uint32_t          height)
 {
     static const struct wpe_view_backend_exportable_fdo_client client = {
         .export_buffer_resource = on_export_buffer_resource,
@@ -633,8 +891,27 @@ cog_drm_modeset_renderer_create_exportable(CogDrmRenderer *renderer, uint32_t wi
         .export_shm_buffer = on_export_shm_buffer,
     };
 
+    return wpe_view_backend_exportable_fdo_create(&client, exportable, width, height);
+}
+
+static void
+cog_drm_modeset_renderer_drop_exportable(CogDrmRenderer *renderer, CogDrmExportable *exportable)
+{
     CogDrmModesetRenderer *self = wl_container_of(renderer, self, base);
-    return (self->exportable = wpe_view_backend_exportable_fdo_create(&client, renderer, width, height));
+
+    /* A frame which was not displayed yet is not going to be. */
+    if (self->mailbox_buffer && self->mailbox_buffer->export.source == exportable)
+        self->mailbox_buffer = NULL;
+    if (self->frame_complete_deferred == exportable) {
+        self->frame_complete_deferred = NULL;
+        exportable->frame_complete_pending = true;
+    }
+
+    struct buffer_object *buffer;
+    wl_list_for_each(buffer, &self->buffer_list, link) {
+        if (buffer->export.source == exportable)
+            drm_release_buffer(buffer);
+    }
 }
 
 CogDrmRenderer *
@@ -652,6 +929,7 @@ cog_drm_modeset_renderer_new(struct gbm_device     *gbm_dev,
         .base.initialize = cog_drm_modeset_renderer_initialize,
         .base.destroy = cog_drm_modeset_renderer_destroy,
         .base.create_exportable = cog_drm_modeset_renderer_create_exportable,
+        .base.drop_exportable = cog_drm_modeset_renderer_drop_exportable,
 
         .drm_source = drm_event_source_new(gbm_device_get_fd(gbm_dev)),
         .gbm_dev = gbm_dev,
@@ -696,6 +974,13 @@ cog_drm_modeset_renderer_new(struct gbm_device     *gbm_dev,
             self->plane_props.props_info[i] = drmModeGetProperty(get_drm_fd(self), self->plane_props.props->props[i]);
     }
 
+    if (self->plane_props.props && atomic_modesetting) {
+        for (uint32_t i = 0; i < self->plane_props.props->count_props; i++) {
+            if (self->plane_props.props_info[i] && !g_strcmp0(self->plane_props.props_info[i]->name, "FB_DAMAGE_CLIPS"))
+                self->fb_damage_clips = true;
+        }
+    }
+
     g_debug("%s: Using plane #%" PRIu32 ", crtc #%" PRIu32 ", connector #%" PRIu32 " (%s).", __func__, plane_id,
             crtc_id, connector_id, atomic_modesetting ? "atomic" : "legacy");
 
@@ -6,6 +6,7 @@
  */
 
 #include "cog-drm-renderer.h"
+#include <wpe/fdo.h>
 
 void
 cog_drm_renderer_destroy(CogDrmRenderer *self)
@@ -15,3 +16,21 @@ cog_drm_renderer_destroy(CogDrmRenderer *self)
         self->destroy(self);
     }
 }
+
+void
+cog_drm_exportable_set_renderer(CogDrmExportable *self, CogDrmRenderer *renderer)
+{
+    if (self->renderer == renderer)
+        return;
+
+    if (self->renderer)
+        cog_drm_renderer_drop_exportable(self->renderer, self);
+
+    self->renderer = renderer;
+
+    /* Let the view produce a new frame, the last one was not presented. */
+    if (self->renderer && self->frame_complete_pending) {
+        self->frame_complete_pending = false;
+        wpe_view_backend_exportable_fdo_dispatch_frame_complete(self->exportable);
+    }
+}
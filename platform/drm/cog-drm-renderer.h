@@ -16,6 +16,20 @@ struct wpe_view_backend_exportable_fdo;
 typedef struct _drmModeModeInfo drmModeModeInfo;
 typedef struct _CogDrmRenderer  CogDrmRenderer;
 
+/*
+ * Source of the frames of a view, used as client data of its exportable.
+ * Views are created before being added to a viewport, and may be hidden or
+ * moved to another one later, so the renderer which presents their frames
+ * is changed by the platform with cog_drm_exportable_set_renderer(). While
+ * there is none frames are released without being presented, and frame
+ * completion is held back until the view has a renderer again.
+ */
+typedef struct {
+    struct wpe_view_backend_exportable_fdo *exportable;
+    CogDrmRenderer                         *renderer; /* Nullable. */
+    bool                                    frame_complete_pending;
+} CogDrmExportable;
+
 struct _CogDrmRenderer {
     const char *name;
 
@@ -24,7 +38,13 @@ struct _CogDrmRenderer {
 
     bool (*set_rotation)(CogDrmRenderer *, CogGLRendererRotation, bool apply);
 
-    struct wpe_view_backend_exportable_fdo *(*create_exportable)(CogDrmRenderer *, uint32_t width, uint32_t height);
+    /* Renderers of the same kind can present frames from any exportable created by one of them. */
+    struct wpe_view_backend_exportable_fdo *(*create_exportable)(CogDrmRenderer *,
+                                                                 CogDrmExportable *,
+                                                                 uint32_t width,
+                                                                 uint32_t height);
+    /* Releases the frames held from an exportable, even if one of them stays on screen. */
+    void (*drop_exportable)(CogDrmRenderer *, CogDrmExportable *);
 };
 
 void cog_drm_renderer_destroy(CogDrmRenderer *self);
@@ -53,11 +73,20 @@ cog_drm_renderer_set_rotation(CogDrmRenderer *self, CogGLRendererRotation rotati
 }
 
 static inline struct wpe_view_backend_exportable_fdo *
-cog_drm_renderer_create_exportable(CogDrmRenderer *self, uint32_t width, uint32_t height)
+cog_drm_renderer_create_exportable(CogDrmRenderer *self, CogDrmExportable *exportable, uint32_t width, uint32_t height)
 {
-    return self->create_exportable(self, width, height);
+    return (exportable->exportable = self->create_exportable(self, exportable, width, height));
 }
 
+static inline void
+cog_drm_renderer_drop_exportable(CogDrmRenderer *self, CogDrmExportable *exportable)
+{
+    if (self->drop_exportable)
+        self->drop_exportable(self, exportable);
+}
+
+void cog_drm_exportable_set_renderer(CogDrmExportable *self, CogDrmRenderer *renderer);
+
 CogDrmRenderer *cog_drm_modeset_renderer_new(struct gbm_device     *dev,
                                              uint32_t               plane_id,
                                              uint32_t               crtc_id,
@@ -0,0 +1,115 @@
+/*
+ * cog-drm-shm-copy-benchmark.c
+ * Copyright (C) 2023 Igalia S.L.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "cog-drm-shm-copy.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Times the copy of SHM buffers into buffer objects done by the modeset
+ * renderer, using plain memory for both. ARGB8888 and XRGB8888 have the
+ * same layout and go through the same code, so only the size and strides
+ * are varied: a mismatched stride forces copying row by row, as when the
+ * driver pads BO rows.
+ */
+
+#define ITERATIONS 30
+
+static int64_t
+now_usec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void
+fill(uint8_t *data, size_t size, uint32_t seed)
+{
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = seed >> 16;
+    }
+}
+
+/* Modifies every tenth row, so a partial update copies 10% of them. */
+static void
+touch_rows(uint8_t *data, uint32_t stride, uint32_t height, uint32_t iteration)
+{
+    for (uint32_t y = iteration % 10; y < height; y += 10)
+        data[(size_t) stride * y] ^= 0xff;
+}
+
+typedef enum {
+    MODE_FULL,      /* No valid hashes, e.g. a newly created BO. */
+    MODE_UNCHANGED, /* Valid hashes, identical frame. */
+    MODE_PARTIAL,   /* Valid hashes, some rows changed. */
+} Mode;
+
+static const char *const mode_names[] = {"full", "unchanged", "partial"};
+
+static void
+run(uint32_t width, uint32_t height, uint32_t dst_padding, Mode mode)
+{
+    const size_t   row_size = (size_t) width * 4;
+    const uint32_t src_stride = row_size;
+    const uint32_t dst_stride = row_size + dst_padding;
+
+    uint8_t  *src = malloc((size_t) src_stride * height);
+    uint8_t  *dst = malloc((size_t) dst_stride * height);
+    uint64_t *hashes = malloc(sizeof(uint64_t) * height);
+    if (!src || !dst || !hashes) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    fill(src, (size_t) src_stride * height, width ^ height);
+    cog_drm_copy_rows(dst, dst_stride, src, src_stride, row_size, height, hashes, false);
+
+    uint64_t copied = 0;
+    int64_t  elapsed = 0;
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        if (mode == MODE_PARTIAL)
+            touch_rows(src, src_stride, height, i);
+
+        const int64_t start = now_usec();
+        copied += cog_drm_copy_rows(dst, dst_stride, src, src_stride, row_size, height, hashes, mode != MODE_FULL);
+        elapsed += now_usec() - start;
+    }
+
+    const double ms_per_frame = (double) elapsed / ITERATIONS / 1000.0;
+    const double mib_per_sec = (double) row_size * height * ITERATIONS / (1024.0 * 1024.0) / (elapsed / 1e6);
+    printf("%4" PRIu32 "x%-4" PRIu32 "  %-10s  %-9s  %7.3f ms/frame  %8.1f MiB/s  %5.1f%% rows copied\n", width,
+           height, dst_padding ? "mismatched" : "equal", mode_names[mode], ms_per_frame, mib_per_sec,
+           100.0 * copied / ((double) height * ITERATIONS));
+
+    free(hashes);
+    free(dst);
+    free(src);
+}
+
+int
+main(void)
+{
+    static const struct {
+        uint32_t width, height;
+    } sizes[] = {
+        {1920, 1080},
+        {3840, 2160},
+    };
+
+    for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        for (uint32_t padding = 0; padding <= 64; padding += 64) {
+            for (Mode mode = MODE_FULL; mode <= MODE_PARTIAL; mode++)
+                run(sizes[i].width, sizes[i].height, padding, mode);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+/*
+ * cog-drm-shm-copy.h
+ * Copyright (C) 2023 Igalia S.L.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Copying of SHM buffers into buffer objects, kept apart from the modeset
+ * renderer so it can be benchmarked without a DRM device.
+ */
+
+/*
+ * Hashes a row of pixels, which is used to find out which rows changed
+ * between frames without reading back from the (usually uncached) BO
+ * memory. Four independent lanes avoid stalling on the multiplications.
+ */
+static inline uint64_t
+cog_drm_hash_row(const uint8_t *data, size_t size)
+{
+    static const uint64_t k = UINT64_C(0x9e3779b97f4a7c15);
+    uint64_t              h[4] = {size, k, k << 1, k << 2};
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (unsigned lane = 0; lane < 4; lane++) {
+            uint64_t word;
+            memcpy(&word, data + i + lane * 8, sizeof(word));
+            h[lane] = (h[lane] ^ word) * k;
+            h[lane] ^= h[lane] >> 29;
+        }
+    }
+    for (; i + 4 <= size; i += 4) {
+        uint32_t word;
+        memcpy(&word, data + i, sizeof(word));
+        h[0] = (h[0] ^ word) * k;
+        h[0] ^= h[0] >> 29;
+    }
+
+    return ((h[0] * k) ^ h[1]) * k ^ ((h[2] * k) ^ h[3]);
+}
+
+/*
+ * Copies height rows of row_size bytes, updating row_hashes. If the hashes
+ * are valid, only rows whose hash changed are copied; otherwise everything
+ * is, at once if both buffers have the same stride. Returns the number of
+ * rows copied.
+ */
+static inline uint32_t
+cog_drm_copy_rows(uint8_t       *dst,
+                  uint32_t       dst_stride,
+                  const uint8_t *src,
+                  uint32_t       src_stride,
+                  size_t         row_size,
+                  uint32_t       height,
+                  uint64_t      *row_hashes,
+                  bool           row_hashes_valid)
+{
+    if (!row_hashes_valid && src_stride == dst_stride) {
+        memcpy(dst, src, (size_t) src_stride * (height - 1) + row_size);
+        for (uint32_t y = 0; y < height; ++y)
+            row_hashes[y] = cog_drm_hash_row(src + (size_t) src_stride * y, row_size);
+        return height;
+    }
+
+    uint32_t copied = 0;
+    for (uint32_t y = 0; y < height; ++y) {
+        uint64_t hash = cog_drm_hash_row(src + (size_t) src_stride * y, row_size);
+        if (row_hashes_valid && row_hashes[y] == hash)
+            continue;
+
+        memcpy(dst + (size_t) dst_stride * y, src + (size_t) src_stride * y, row_size);
+        row_hashes[y] = hash;
+        copied++;
+    }
+    return copied;
+}
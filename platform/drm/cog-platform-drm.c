@@ -62,10 +62,23 @@ struct _CogDrmPlatformClass {
     CogPlatformClass parent_class;
 };
 
+/*
+ * Output driven by the platform, with the renderer used to present the
+ * visible view of the viewport shown in it.
+ */
+typedef struct {
+    unsigned        index;    /* In drm_data.outputs. */
+    CogDrmRenderer *renderer; /* Created along with the first viewport shown. */
+    CogViewport    *viewport; /* Shown in the output, if any. */
+} CogDrmOutput;
+
 struct _CogDrmPlatform {
     CogPlatform            parent;
-    CogView               *web_view;
-    CogDrmRenderer        *renderer;
+    CogView               *web_view;      /* Shown in the primary output, receives input. */
+    CogDrmRenderer        *renderer;      /* Renderer of the primary output. */
+    GPtrArray             *outputs;       /* CogDrmOutput, in the same order as drm_data.outputs. */
+    GPtrArray             *viewports;     /* CogViewport, in order of creation. */
+    GPtrArray             *view_backends; /* CogDrmViewBackendData, of every view. */
     CogGLRendererRotation  rotation;
     GList                 *rotatable_input_devices;
     bool                   use_gles;
@@ -91,6 +104,14 @@ G_DEFINE_DYNAMIC_TYPE_EXTENDED(
     0,
     g_io_extension_point_implement(COG_MODULES_PLATFORM_EXTENSION_POINT, g_define_type_id, "drm", 200);)
 
+struct drm_output {
+    uint32_t        connector_id;
+    uint32_t        crtc_id;
+    uint32_t        crtc_index;
+    uint32_t        plane_id;
+    drmModeModeInfo mode;
+};
+
 static struct {
     int fd;
     drmModeRes *base_resources;
@@ -121,6 +142,8 @@ static struct {
     bool atomic_modesetting;
     bool addfb2_modifiers;
     bool mode_set;
+
+    GArray *outputs; /* struct drm_output, the first one is the primary output. */
 } drm_data = {
     .fd = -1,
     .base_resources = NULL,
@@ -149,6 +172,7 @@ static struct {
     .device_scale = 1.0,
     .atomic_modesetting = true,
     .mode_set = false,
+    .outputs = NULL,
 };
 
 static struct {
@@ -156,8 +180,11 @@ static struct {
     struct kms_device *device;
     struct kms_plane *plane;
     struct kms_framebuffer *cursor;
-    unsigned int x;
-    unsigned int y;
+    uint32_t crtc_id;
+    bool legacy;
+    bool dirty;
+    double x;
+    double y;
     unsigned int screen_width;
     unsigned int screen_height;
 } cursor = {
@@ -218,10 +245,6 @@ static struct {
     .key_repeat_source = NULL,
 };
 
-static struct {
-    struct wpe_view_backend_exportable_fdo *exportable;
-} wpe_host_data;
-
 static struct {
     struct wpe_view_backend *backend;
 } wpe_view_data;
@@ -315,6 +338,8 @@ clear_drm (void)
     g_clear_pointer (&drm_data.crtc.obj, drmModeFreeCrtc);
     g_clear_pointer (&drm_data.connector.obj, drmModeFreeConnector);
 
+    g_clear_pointer(&drm_data.outputs, g_array_unref);
+
     if (drm_data.fd != -1) {
         close (drm_data.fd);
         drm_data.fd = -1;
@@ -358,6 +383,189 @@ find_crtc_for_encoder(const drmModeRes *resources, const drmModeEncoder *encoder
     return -1;
 }
 
+static drmModeModeInfo *
+choose_mode(drmModeConnector *connector)
+{
+    const char *user_selected_mode = g_getenv("COG_PLATFORM_DRM_VIDEO_MODE");
+
+    int user_max_width = 0;
+    int user_max_height = 0;
+    int user_max_refresh = 0;
+
+    const char *user_mode_max = g_getenv("COG_PLATFORM_DRM_MODE_MAX");
+    if (user_mode_max) {
+        if (sscanf(user_mode_max, "%dx%d@%d", &user_max_width, &user_max_height, &user_max_refresh) < 2 ||
+            user_max_width < 0 || user_max_height < 0 || user_max_refresh < 0) {
+            fprintf(stderr, "invalid value for COG_PLATFORM_DRM_MODE_MAX\n");
+            user_max_width = 0;
+            user_max_height = 0;
+            user_max_refresh = 0;
+        }
+    }
+
+    drmModeModeInfo *mode = NULL;
+    for (int i = 0, area = 0; i < connector->count_modes; ++i) {
+        drmModeModeInfo *current_mode = &connector->modes[i];
+        if (user_selected_mode && strcmp(user_selected_mode, current_mode->name) != 0) {
+            continue;
+        }
+
+        if (user_max_width && current_mode->hdisplay > user_max_width) {
+            continue;
+        }
+        if (user_max_height && current_mode->vdisplay > user_max_height) {
+            continue;
+        }
+        if (user_max_refresh && current_mode->vrefresh > user_max_refresh) {
+            continue;
+        }
+
+        if (current_mode->type & DRM_MODE_TYPE_PREFERRED) {
+            mode = current_mode;
+            break;
+        }
+
+        int current_area = current_mode->hdisplay * current_mode->vdisplay;
+        if (current_area > area) {
+            mode = current_mode;
+            area = current_area;
+        }
+    }
+
+    return mode;
+}
+
+static bool
+is_primary_plane(uint32_t plane_id)
+{
+    bool is_primary = false;
+
+    drmModeObjectProperties *plane_props = drmModeObjectGetProperties (drm_data.fd, plane_id, DRM_MODE_OBJECT_PLANE);
+    if (!plane_props)
+        return false;
+
+    for (int j = 0; j < plane_props->count_props; ++j) {
+        drmModePropertyRes *prop = drmModeGetProperty (drm_data.fd, plane_props->props[j]);
+        is_primary = !g_strcmp0 (prop->name, "type")
+                          && plane_props->prop_values[j] == DRM_PLANE_TYPE_PRIMARY;
+        drmModeFreeProperty (prop);
+
+        if (is_primary)
+            break;
+    }
+
+    drmModeFreeObjectProperties (plane_props);
+    return is_primary;
+}
+
+/*
+ * Finds the primary plane usable with a CRTC, or the last usable plane
+ * of any other type if there is no primary one.
+ */
+static uint32_t
+find_plane_for_crtc(uint32_t crtc_index)
+{
+    uint32_t plane_id = 0;
+
+    for (int i = 0; i < drm_data.plane_resources->count_planes; ++i) {
+        drmModePlane *plane = drmModeGetPlane (drm_data.fd, drm_data.plane_resources->planes[i]);
+        if (!plane)
+            continue;
+
+        const bool usable = plane->possible_crtcs & (1 << crtc_index);
+        drmModeFreePlane (plane);
+        if (!usable)
+            continue;
+
+        plane_id = drm_data.plane_resources->planes[i];
+        if (is_primary_plane(plane_id))
+            break;
+    }
+
+    return plane_id;
+}
+
+/*
+ * Finds a CRTC not in the used_crtcs mask which can drive the connector,
+ * preferring the one currently driving it, if any.
+ */
+static int
+find_crtc_index_for_connector(const drmModeConnector *connector, uint32_t used_crtcs)
+{
+    int crtc_index = -1;
+
+    for (int i = 0; i < connector->count_encoders; ++i) {
+        drmModeEncoder *encoder = drmModeGetEncoder(drm_data.fd, connector->encoders[i]);
+        if (!encoder)
+            continue;
+
+        for (int j = 0; j < drm_data.base_resources->count_crtcs; ++j) {
+            if (!(encoder->possible_crtcs & (1 << j)) || (used_crtcs & (1 << j)))
+                continue;
+
+            if (encoder->crtc_id == drm_data.base_resources->crtcs[j]) {
+                drmModeFreeEncoder(encoder);
+                return j;
+            }
+            if (crtc_index < 0)
+                crtc_index = j;
+        }
+
+        drmModeFreeEncoder(encoder);
+    }
+
+    return crtc_index;
+}
+
+/*
+ * Adds the connected connectors other than the primary one to the list of
+ * outputs, each with its own CRTC and plane.
+ */
+static void
+init_drm_secondary_outputs(void)
+{
+    uint32_t used_crtcs = 1 << drm_data.crtc.index;
+
+    for (int i = 0; i < drm_data.base_resources->count_connectors; ++i) {
+        if (drm_data.base_resources->connectors[i] == drm_data.connector.obj_id)
+            continue;
+
+        drmModeConnector *connector = drmModeGetConnector(drm_data.fd, drm_data.base_resources->connectors[i]);
+        if (!connector)
+            continue;
+        if (connector->connection != DRM_MODE_CONNECTED) {
+            drmModeFreeConnector(connector);
+            continue;
+        }
+
+        drmModeModeInfo *mode = choose_mode(connector);
+        int              crtc_index = mode ? find_crtc_index_for_connector(connector, used_crtcs) : -1;
+        uint32_t         plane_id = (crtc_index >= 0) ? find_plane_for_crtc(crtc_index) : 0;
+        if (!plane_id) {
+            g_debug("init_drm: no usable mode, crtc, or plane for connector id %u, skipping", connector->connector_id);
+            drmModeFreeConnector(connector);
+            continue;
+        }
+
+        used_crtcs |= 1 << crtc_index;
+
+        struct drm_output output = {
+            .connector_id = connector->connector_id,
+            .crtc_id = drm_data.base_resources->crtcs[crtc_index],
+            .crtc_index = crtc_index,
+            .plane_id = plane_id,
+            .mode = *mode,
+        };
+        g_array_append_val(drm_data.outputs, output);
+
+        g_debug("init_drm: output %u uses connector id %u, crtc id %u, plane id %u, mode '%s' @ %dHz",
+                drm_data.outputs->len - 1, output.connector_id, output.crtc_id, output.plane_id, output.mode.name,
+                output.mode.vrefresh);
+
+        drmModeFreeConnector(connector);
+    }
+}
+
 static gboolean
 init_drm(void)
 {
@@ -386,7 +594,11 @@ init_drm(void)
         if (!(device->available_nodes & (1 << DRM_NODE_PRIMARY)))
             continue;
 
-        drm_data.fd = open (device->nodes[DRM_NODE_PRIMARY], O_RDWR);
+        /*
+         * Each renderer watches the device for its own page flip events; with
+         * more than one output, a renderer may find its events already read.
+         */
+        drm_data.fd = open (device->nodes[DRM_NODE_PRIMARY], O_RDWR | O_NONBLOCK);
         if (drm_data.fd < 0)
             continue;
 
@@ -449,50 +661,7 @@ init_drm(void)
     g_debug("init_drm: using connector id %d, type %d", drm_data.connector.obj->connector_id,
             drm_data.connector.obj->connector_type);
 
-    const char *user_selected_mode = g_getenv("COG_PLATFORM_DRM_VIDEO_MODE");
-
-    int user_max_width = 0;
-    int user_max_height = 0;
-    int user_max_refresh = 0;
-
-    const char *user_mode_max = g_getenv("COG_PLATFORM_DRM_MODE_MAX");
-    if (user_mode_max) {
-        if (sscanf(user_mode_max, "%dx%d@%d", &user_max_width, &user_max_height, &user_max_refresh) < 2 ||
-            user_max_width < 0 || user_max_height < 0 || user_max_refresh < 0) {
-            fprintf(stderr, "invalid value for COG_PLATFORM_DRM_MODE_MAX\n");
-            user_max_width = 0;
-            user_max_height = 0;
-            user_max_refresh = 0;
-        }
-    }
-
-    for (int i = 0, area = 0; i < drm_data.connector.obj->count_modes; ++i) {
-        drmModeModeInfo *current_mode = &drm_data.connector.obj->modes[i];
-        if (user_selected_mode && strcmp(user_selected_mode, current_mode->name) != 0) {
-            continue;
-        }
-
-        if (user_max_width && current_mode->hdisplay > user_max_width) {
-            continue;
-        }
-        if (user_max_height && current_mode->vdisplay > user_max_height) {
-            continue;
-        }
-        if (user_max_refresh && current_mode->vrefresh > user_max_refresh) {
-            continue;
-        }
-
-        if (current_mode->type & DRM_MODE_TYPE_PREFERRED) {
-            drm_data.mode = current_mode;
-            break;
-        }
-
-        int current_area = current_mode->hdisplay * current_mode->vdisplay;
-        if (current_area > area) {
-            drm_data.mode = current_mode;
-            area = current_area;
-        }
-    }
+    drm_data.mode = choose_mode(drm_data.connector.obj);
     if (!drm_data.mode)
         return FALSE;
 
@@ -536,46 +705,26 @@ init_drm(void)
     if (!drm_data.plane_resources)
         return FALSE;
 
-    for (int i = 0; i < drm_data.plane_resources->count_planes; ++i) {
-        uint32_t plane_id = drm_data.plane_resources->planes[i];
-        drmModePlane *plane = drmModeGetPlane (drm_data.fd, plane_id);
-        if (!plane)
-            continue;
-
-        if (!(plane->possible_crtcs & (1 << drm_data.crtc.index))) {
-            drmModeFreePlane (plane);
-            continue;
-        }
-
-        g_clear_pointer (&drm_data.plane.obj, drmModeFreePlane);
-        drm_data.plane.obj_id = 0;
-
-        drm_data.plane.obj = plane;
-        drm_data.plane.obj_id = plane_id;
-        bool is_primary = false;
-
-        drmModeObjectProperties *plane_props = drmModeObjectGetProperties (drm_data.fd, plane_id, DRM_MODE_OBJECT_PLANE);
-
-        for (int j = 0; j < plane_props->count_props; ++j) {
-            drmModePropertyRes *prop = drmModeGetProperty (drm_data.fd, plane_props->props[j]);
-            is_primary = !g_strcmp0 (prop->name, "type")
-                              && plane_props->prop_values[j] == DRM_PLANE_TYPE_PRIMARY;
-            drmModeFreeProperty (prop);
-
-            if (is_primary)
-                break;
-        }
-
-        drmModeFreeObjectProperties (plane_props);
-
-        if (is_primary)
-            break;
-    }
+    drm_data.plane.obj_id = find_plane_for_crtc(drm_data.crtc.index);
+    if (drm_data.plane.obj_id)
+        drm_data.plane.obj = drmModeGetPlane (drm_data.fd, drm_data.plane.obj_id);
 
     drm_data.width = drm_data.mode->hdisplay;
     drm_data.height = drm_data.mode->vdisplay;
     drm_data.refresh = drm_data.mode->vrefresh;
 
+    drm_data.outputs = g_array_new(FALSE, TRUE, sizeof(struct drm_output));
+    struct drm_output primary_output = {
+        .connector_id = drm_data.connector.obj_id,
+        .crtc_id = drm_data.crtc.obj_id,
+        .crtc_index = drm_data.crtc.index,
+        .plane_id = drm_data.plane.obj_id,
+        .mode = *drm_data.mode,
+    };
+    g_array_append_val(drm_data.outputs, primary_output);
+
+    init_drm_secondary_outputs();
+
     g_clear_pointer(&drm_data.base_resources, drmModeFreeResources);
     g_clear_pointer(&drm_data.plane_resources, drmModeFreePlaneResources);
 
@@ -600,6 +749,9 @@ choose_format (struct kms_plane *plane)
 
 static void
 clear_cursor (void) {
+    if (cursor.legacy)
+        drmModeSetCursor(drm_data.fd, cursor.crtc_id, 0, 0, 0);
+    cursor.legacy = false;
     g_clear_pointer(&cursor.cursor, kms_framebuffer_free);
     g_clear_pointer(&cursor.device, kms_device_free);
     cursor.plane = NULL;
@@ -618,30 +770,54 @@ init_cursor (void)
     if (!cursor.device)
         return FALSE;
 
-    cursor.plane = kms_device_find_plane_by_type(cursor.device, DRM_PLANE_TYPE_CURSOR, 0);
-    if (!cursor.plane) {
-        g_clear_pointer(&cursor.device, kms_device_free);
-        return FALSE;
-    }
+    cursor.crtc_id = drm_data.crtc.obj_id;
+    cursor.screen_width = drm_data.width;
+    cursor.screen_height = drm_data.height;
 
-    uint32_t format = choose_format(cursor.plane);
-    if (!format) {
-        g_clear_pointer(&cursor.device, kms_device_free);
-        return FALSE;
-    }
+    /*
+     * Prefer the legacy cursor ioctls: with atomic drivers they become
+     * asynchronous cursor plane updates, which neither wait for vblank
+     * nor fail with EBUSY while a page flip is pending on the CRTC. The
+     * buffer must be ARGB8888 and have the size reported by the driver.
+     */
+    uint64_t width = 64, height = 64;
+    drmGetCap(drm_data.fd, DRM_CAP_CURSOR_WIDTH, &width);
+    drmGetCap(drm_data.fd, DRM_CAP_CURSOR_HEIGHT, &height);
+
+    cursor.cursor = create_cursor_framebuffer(cursor.device, DRM_FORMAT_ARGB8888, width, height);
+    if (cursor.cursor &&
+        drmModeSetCursor(drm_data.fd, cursor.crtc_id, cursor.cursor->handle, cursor.cursor->width,
+                         cursor.cursor->height) == 0) {
+        cursor.legacy = true;
+    } else {
+        g_debug("%s: Legacy cursor unavailable, using the cursor plane", __func__);
+        g_clear_pointer(&cursor.cursor, kms_framebuffer_free);
 
-    cursor.cursor = create_cursor_framebuffer(cursor.device, format);
-    if (!cursor.cursor) {
-        g_clear_pointer(&cursor.device, kms_device_free);
-        return FALSE;
+        cursor.plane = kms_device_find_plane_by_type(cursor.device, DRM_PLANE_TYPE_CURSOR, 0);
+        if (!cursor.plane) {
+            g_clear_pointer(&cursor.device, kms_device_free);
+            return FALSE;
+        }
+
+        uint32_t format = choose_format(cursor.plane);
+        if (!format) {
+            g_clear_pointer(&cursor.device, kms_device_free);
+            return FALSE;
+        }
+
+        cursor.cursor = create_cursor_framebuffer(cursor.device, format, 0, 0);
+        if (!cursor.cursor) {
+            g_clear_pointer(&cursor.device, kms_device_free);
+            return FALSE;
+        }
     }
 
-    cursor.x = (cursor.device->screens[0]->width - cursor.cursor->width) / 2;
-    cursor.y = (cursor.device->screens[0]->height - cursor.cursor->height) / 2;
-    cursor.screen_width = cursor.device->screens[0]->width;
-    cursor.screen_height = cursor.device->screens[0]->height;
+    cursor.x = cursor.screen_width / 2;
+    cursor.y = cursor.screen_height / 2;
 
-    if (kms_plane_set(cursor.plane, cursor.cursor, cursor.x, cursor.y)) {
+    if (cursor.legacy) {
+        drmModeMoveCursor(drm_data.fd, cursor.crtc_id, cursor.x, cursor.y);
+    } else if (kms_plane_set(cursor.plane, cursor.cursor, cursor.x, cursor.y)) {
         g_clear_pointer(&cursor.device, kms_device_free);
         g_clear_pointer(&cursor.cursor, kms_framebuffer_free);
         return FALSE;
@@ -890,6 +1066,24 @@ input_handle_touch_event (enum libinput_event_type touch_type, struct libinput_e
     }
 }
 
+/*
+ * Moves the cursor to the last position seen, once per batch of input
+ * events. The legacy ioctl does not wait for page flips; the cursor plane
+ * fallback may, but at most once per batch instead of once per event.
+ */
+static void
+cursor_update(void)
+{
+    if (!cursor.dirty)
+        return;
+
+    cursor.dirty = false;
+    if (cursor.legacy)
+        drmModeMoveCursor(drm_data.fd, cursor.crtc_id, cursor.x, cursor.y);
+    else
+        kms_plane_set(cursor.plane, cursor.cursor, cursor.x, cursor.y);
+}
+
 static void
 input_handle_pointer_motion_event(struct libinput_event_pointer *pointer_event, bool absolute)
 {
@@ -927,7 +1121,7 @@ input_handle_pointer_motion_event(struct libinput_event_pointer *pointer_event,
     };
 
     wpe_view_backend_dispatch_pointer_event(wpe_view_data.backend, &event);
-    kms_plane_set(cursor.plane, cursor.cursor, cursor.x, cursor.y);
+    cursor.dirty = true;
 }
 
 static void
@@ -1230,6 +1424,9 @@ input_process_events (void)
 
         libinput_event_destroy (event);
     }
+
+    if (cursor.enabled)
+        cursor_update();
 }
 
 static int
@@ -1430,6 +1627,50 @@ gamepad_provider_get_view_backend_for_gamepad(void *provider G_GNUC_UNUSED, void
     return wpe_view_data.backend;
 }
 
+/*
+ * Creates the renderer for an output, applying the current rotation.
+ * Returns false if the rotation is not supported, in which case the
+ * output is left unrotated. The renderer of the primary output is
+ * available as CogDrmPlatform.renderer, and its rotation determines
+ * that of the input devices.
+ */
+static bool
+cog_drm_platform_create_renderer(CogDrmPlatform *self, CogDrmOutput *output)
+{
+    const struct drm_output *drm_output = &g_array_index(drm_data.outputs, struct drm_output, output->index);
+
+    if (self->use_gles) {
+        output->renderer = cog_drm_gles_renderer_new(gbm_data.device,
+                                                     egl_data.display,
+                                                     drm_output->plane_id,
+                                                     drm_output->crtc_id,
+                                                     drm_output->connector_id,
+                                                     &drm_output->mode,
+                                                     drm_data.atomic_modesetting);
+    } else {
+        output->renderer = cog_drm_modeset_renderer_new(gbm_data.device,
+                                                        drm_output->plane_id,
+                                                        drm_output->crtc_id,
+                                                        drm_output->connector_id,
+                                                        &drm_output->mode,
+                                                        drm_data.atomic_modesetting);
+    }
+
+    if (output->index == 0)
+        self->renderer = output->renderer;
+
+    if (cog_drm_renderer_supports_rotation(output->renderer, self->rotation)) {
+        cog_drm_renderer_set_rotation(output->renderer, self->rotation);
+        return true;
+    }
+
+    if (output->index == 0)
+        self->rotation = COG_GL_RENDERER_ROTATION_0;
+    return false;
+}
+
+static void cog_drm_platform_bind_viewports(CogDrmPlatform *self);
+
 static gboolean
 cog_drm_platform_setup(CogPlatform *platform, CogShell *shell, const char *params, GError **error)
 {
@@ -1479,29 +1720,19 @@ cog_drm_platform_setup(CogPlatform *platform, CogShell *shell, const char *param
         return FALSE;
     }
 
-    if (self->use_gles) {
-        self->renderer = cog_drm_gles_renderer_new(gbm_data.device,
-                                                   egl_data.display,
-                                                   drm_data.plane.obj_id,
-                                                   drm_data.crtc.obj_id,
-                                                   drm_data.connector.obj_id,
-                                                   drm_data.mode,
-                                                   drm_data.atomic_modesetting);
-    } else {
-        self->renderer = cog_drm_modeset_renderer_new(gbm_data.device,
-                                                      drm_data.plane.obj_id,
-                                                      drm_data.crtc.obj_id,
-                                                      drm_data.connector.obj_id,
-                                                      drm_data.mode,
-                                                      drm_data.atomic_modesetting);
-    }
-    if (cog_drm_renderer_supports_rotation(self->renderer, self->rotation)) {
-        cog_drm_renderer_set_rotation(self->renderer, self->rotation);
-    } else {
+    self->outputs = g_ptr_array_new_full(drm_data.outputs->len, g_free);
+    for (unsigned i = 0; i < drm_data.outputs->len; i++) {
+        CogDrmOutput *output = g_new0(CogDrmOutput, 1);
+        output->index = i;
+        g_ptr_array_add(self->outputs, output);
+    }
+    g_debug("%s: %u output(s) available.", __func__, self->outputs->len);
+
+    /* Renderers for the other outputs are created along with their viewports. */
+    CogDrmOutput *primary_output = g_ptr_array_index(self->outputs, 0);
+    if (!cog_drm_platform_create_renderer(self, primary_output))
         g_warning("Renderer '%s' does not support rotation %u (%u degrees).", self->renderer->name, self->rotation,
                   self->rotation * 90);
-        self->rotation = COG_GL_RENDERER_ROTATION_0;
-    }
 
     if (!init_input(COG_DRM_PLATFORM(platform))) {
         g_set_error_literal (error,
@@ -1519,27 +1750,66 @@ cog_drm_platform_setup(CogPlatform *platform, CogShell *shell, const char *param
         return FALSE;
     }
 
-    if (self->renderer->initialize) {
-        if (!self->renderer->initialize(self->renderer, error))
-            return FALSE;
-    }
+    if (!cog_drm_renderer_initialize(self->renderer, error))
+        return FALSE;
     g_debug("%s: Renderer '%s' initialized.", __func__, self->renderer->name);
 
     wpe_fdo_initialize_for_egl_display (egl_data.display);
 
     cog_gamepad_setup(gamepad_provider_get_view_backend_for_gamepad);
 
+    /* Viewports may have been created before the outputs were known. */
+    cog_drm_platform_bind_viewports(self);
+
     return TRUE;
 }
 
+typedef struct {
+    CogDrmExportable exportable;
+    CogDrmPlatform  *platform; /* Cleared if the platform goes away before the view. */
+    CogView         *view;     /* Set by init_web_view(). */
+} CogDrmViewBackendData;
+
+static void
+cog_drm_view_backend_data_free(CogDrmViewBackendData *data)
+{
+    struct wpe_view_backend *backend = wpe_view_backend_exportable_fdo_get_view_backend(data->exportable.exportable);
+    if (wpe_view_data.backend == backend)
+        wpe_view_data.backend = NULL;
+
+    CogDrmPlatform *self = data->platform;
+    if (self) {
+        if (self->web_view == data->view)
+            self->web_view = NULL;
+        g_ptr_array_remove_fast(self->view_backends, data);
+    }
+
+    cog_drm_exportable_set_renderer(&data->exportable, NULL);
+    wpe_view_backend_exportable_fdo_destroy(data->exportable.exportable);
+    g_free(data);
+}
+
 static void
 cog_drm_platform_finalize(GObject *object)
 {
     CogDrmPlatform *self = COG_DRM_PLATFORM(object);
 
-    g_idle_remove_by_data(&wpe_view_data);
+    for (unsigned i = 0; i < self->view_backends->len; i++) {
+        CogDrmViewBackendData *data = g_ptr_array_index(self->view_backends, i);
+        cog_drm_exportable_set_renderer(&data->exportable, NULL);
+        data->platform = NULL;
+    }
+    g_clear_pointer(&self->view_backends, g_ptr_array_unref);
+    g_clear_pointer(&self->viewports, g_ptr_array_unref);
 
-    g_clear_pointer(&self->renderer, cog_drm_renderer_destroy);
+    if (self->outputs) {
+        for (unsigned i = 0; i < self->outputs->len; i++) {
+            CogDrmOutput *output = g_ptr_array_index(self->outputs, i);
+            g_clear_pointer(&output->renderer, cog_drm_renderer_destroy);
+        }
+    }
+    g_clear_pointer(&self->outputs, g_ptr_array_unref);
+    self->renderer = NULL;
 
     clear_glib();
     clear_input(self);
@@ -1551,42 +1821,231 @@ cog_drm_platform_finalize(GObject *object)
     G_OBJECT_CLASS(cog_drm_platform_parent_class)->finalize(object);
 }
 
+/* Finds the output which shows a viewport, or a free output for NULL. */
+static CogDrmOutput *
+cog_drm_platform_find_output(CogDrmPlatform *self, CogViewport *viewport)
+{
+    for (unsigned i = 0; i < self->outputs->len; i++) {
+        CogDrmOutput *output = g_ptr_array_index(self->outputs, i);
+        if (output->viewport == viewport)
+            return output;
+    }
+    return NULL;
+}
+
+/* Logical size of the views shown in an output. */
+static void
+cog_drm_platform_get_view_size(CogDrmPlatform *self, CogDrmOutput *output, uint32_t *width, uint32_t *height)
+{
+    const struct drm_output *drm_output = &g_array_index(drm_data.outputs, struct drm_output, output->index);
+
+    switch (self->rotation) {
+    case COG_GL_RENDERER_ROTATION_0:
+    case COG_GL_RENDERER_ROTATION_180:
+        *width = drm_output->mode.hdisplay / drm_data.device_scale;
+        *height = drm_output->mode.vdisplay / drm_data.device_scale;
+        break;
+    case COG_GL_RENDERER_ROTATION_90:
+    case COG_GL_RENDERER_ROTATION_270:
+        *width = drm_output->mode.vdisplay / drm_data.device_scale;
+        *height = drm_output->mode.hdisplay / drm_data.device_scale;
+        break;
+    default:
+        g_assert_not_reached();
+    }
+}
+
+/*
+ * Routes the frames of the visible view of each viewport to the renderer of
+ * its output. Frames from the rest of views are not presented anywhere. When
+ * resizing, views shown in an output are resized even if they stay there.
+ */
+static void
+cog_drm_platform_update_views(CogDrmPlatform *self, bool resize)
+{
+    if (!self->outputs)
+        return;
+
+    for (unsigned i = 0; i < self->view_backends->len; i++) {
+        CogDrmViewBackendData *data = g_ptr_array_index(self->view_backends, i);
+        if (!data->view)
+            continue;
+
+        CogDrmOutput *output = NULL;
+        if (cog_view_is_visible(data->view)) {
+            g_autoptr(CogViewport) viewport = cog_view_get_viewport(data->view);
+            output = cog_drm_platform_find_output(self, viewport);
+        }
+
+        if (!output) {
+            cog_drm_exportable_set_renderer(&data->exportable, NULL);
+            continue;
+        }
+        if (!resize && data->exportable.renderer == output->renderer)
+            continue;
+
+        const struct drm_output *drm_output = &g_array_index(drm_data.outputs, struct drm_output, output->index);
+        struct wpe_view_backend *backend = cog_view_get_backend(data->view);
+
+        uint32_t width, height;
+        cog_drm_platform_get_view_size(self, output, &width, &height);
+        wpe_view_backend_dispatch_set_size(backend, width, height);
+        wpe_view_backend_set_target_refresh_rate(backend, drm_output->mode.vrefresh * 1000);
+
+        cog_drm_exportable_set_renderer(&data->exportable, output->renderer);
+
+        /* Input devices are mapped to the primary output. */
+        if (output->index == 0) {
+            self->web_view = data->view;
+            wpe_view_data.backend = backend;
+        }
+
+        g_debug("%s: View %p shown in output %u.", G_STRFUNC, data->view, output->index);
+    }
+}
+
+/*
+ * Shows viewports which do not have an output in the free ones, in order
+ * of creation. Viewports left without an output are not shown until one
+ * becomes available.
+ */
+static void
+cog_drm_platform_bind_viewports(CogDrmPlatform *self)
+{
+    if (!self->outputs)
+        return;
+
+    for (unsigned i = 0; i < self->viewports->len; i++) {
+        CogViewport *viewport = g_ptr_array_index(self->viewports, i);
+        if (cog_drm_platform_find_output(self, viewport))
+            continue;
+
+        CogDrmOutput *output = cog_drm_platform_find_output(self, NULL);
+        if (!output) {
+            g_debug("%s: No output available for viewport %p.", G_STRFUNC, viewport);
+            break;
+        }
+
+        if (!output->renderer) {
+            if (!cog_drm_platform_create_renderer(self, output)) {
+                g_warning("Renderer '%s' does not support rotation %u (%u degrees) in output %u.",
+                          output->renderer->name, self->rotation, self->rotation * 90, output->index);
+            }
+
+            g_autoptr(GError) error = NULL;
+            if (!cog_drm_renderer_initialize(output->renderer, &error)) {
+                g_warning("Cannot initialize renderer for output %u: %s", output->index, error->message);
+                g_clear_pointer(&output->renderer, cog_drm_renderer_destroy);
+                break;
+            }
+            g_debug("%s: Renderer '%s' initialized for output %u.", G_STRFUNC, output->renderer->name,
+                    output->index);
+        }
+
+        output->viewport = viewport;
+        g_debug("%s: Viewport %p shown in output %u.", G_STRFUNC, viewport, output->index);
+    }
+
+    cog_drm_platform_update_views(self, false);
+}
+
+static void
+cog_drm_platform_on_notify_visible_view(CogDrmPlatform *self, GParamSpec *pspec G_GNUC_UNUSED, CogViewport *viewport)
+{
+    g_debug("%s: Visible view %p in viewport %p.", G_STRFUNC, cog_viewport_get_visible_view(viewport), viewport);
+    cog_drm_platform_update_views(self, false);
+}
+
+static void
+cog_drm_platform_viewport_created(CogPlatform *platform, CogViewport *viewport)
+{
+    CogDrmPlatform *self = COG_DRM_PLATFORM(platform);
+
+    g_assert(!g_ptr_array_find(self->viewports, viewport, NULL));
+    g_ptr_array_add(self->viewports, viewport);
+
+    g_signal_connect_object(viewport, "notify::visible-view", G_CALLBACK(cog_drm_platform_on_notify_visible_view),
+                            platform, G_CONNECT_AFTER | G_CONNECT_SWAPPED);
+
+    cog_drm_platform_bind_viewports(self);
+}
+
+static void
+cog_drm_platform_viewport_disposed(CogPlatform *platform, CogViewport *viewport)
+{
+    CogDrmPlatform *self = COG_DRM_PLATFORM(platform);
+
+    gboolean removed G_GNUC_UNUSED = g_ptr_array_remove(self->viewports, viewport);
+    g_assert(removed);
+
+    if (self->outputs) {
+        CogDrmOutput *output = cog_drm_platform_find_output(self, viewport);
+        if (output)
+            output->viewport = NULL;
+    }
+
+    /* The output may be used by a viewport which was left without one. */
+    cog_drm_platform_bind_viewports(self);
+}
+
 static WebKitWebViewBackend *
 cog_drm_platform_get_view_backend(CogPlatform *platform, WebKitWebView *related_view, GError **error)
 {
     CogDrmPlatform *self = COG_DRM_PLATFORM(platform);
-    wpe_host_data.exportable = self->renderer->create_exportable(self->renderer,
-                                                                 drm_data.width / drm_data.device_scale,
-                                                                 drm_data.height / drm_data.device_scale);
-    g_assert (wpe_host_data.exportable);
 
-    wpe_view_data.backend = wpe_view_backend_exportable_fdo_get_view_backend (wpe_host_data.exportable);
-    g_assert (wpe_view_data.backend);
+    CogDrmViewBackendData *data = g_new0(CogDrmViewBackendData, 1);
+    data->platform = self;
+
+    /* Views get the size of their output once shown, until then use the primary one. */
+    uint32_t width, height;
+    cog_drm_platform_get_view_size(self, g_ptr_array_index(self->outputs, 0), &width, &height);
+
+    struct wpe_view_backend_exportable_fdo *exportable =
+        cog_drm_renderer_create_exportable(self->renderer, &data->exportable, width, height);
+    g_assert (exportable);
+
+    struct wpe_view_backend *view_backend = wpe_view_backend_exportable_fdo_get_view_backend(exportable);
+    g_assert (view_backend);
+
+    g_ptr_array_add(self->view_backends, data);
 
     WebKitWebViewBackend *wk_view_backend =
-        webkit_web_view_backend_new (wpe_view_data.backend,
-                                     (GDestroyNotify) wpe_view_backend_exportable_fdo_destroy,
-                                     wpe_host_data.exportable);
+        webkit_web_view_backend_new(view_backend, (GDestroyNotify) cog_drm_view_backend_data_free, data);
     g_assert (wk_view_backend);
 
+    g_debug("%s: New view backend %p.", __func__, view_backend);
     return wk_view_backend;
 }
 
-static gboolean
-set_target_refresh_rate(gpointer user_data)
-{
-    wpe_view_backend_set_target_refresh_rate(wpe_view_data.backend, drm_data.refresh * 1000);
-    return G_SOURCE_REMOVE;
-}
-
 static void
 cog_drm_platform_init_web_view(CogPlatform *platform, WebKitWebView *view)
 {
-    COG_DRM_PLATFORM(platform)->web_view = COG_VIEW(view);
+    CogDrmPlatform *self = COG_DRM_PLATFORM(platform);
+
+    struct wpe_view_backend *backend = webkit_web_view_backend_get_wpe_backend(webkit_web_view_get_backend(view));
+
+    CogDrmViewBackendData *data = NULL;
+    for (unsigned i = 0; i < self->view_backends->len; i++) {
+        CogDrmViewBackendData *candidate = g_ptr_array_index(self->view_backends, i);
+        if (wpe_view_backend_exportable_fdo_get_view_backend(candidate->exportable.exportable) == backend) {
+            data = candidate;
+            break;
+        }
+    }
+    g_return_if_fail(data);
+
+    data->view = COG_VIEW(view);
 
-    wpe_view_backend_dispatch_set_device_scale_factor(wpe_view_data.backend, drm_data.device_scale);
+    /* Until a view is shown in the primary output, input goes to the first one. */
+    if (!self->web_view) {
+        self->web_view = data->view;
+        wpe_view_data.backend = backend;
+    }
 
-    g_idle_add(G_SOURCE_FUNC(set_target_refresh_rate), &wpe_view_data);
+    wpe_view_backend_dispatch_set_device_scale_factor(backend, drm_data.device_scale);
+
+    /* The view may be in a viewport already. */
+    cog_drm_platform_update_views(self, false);
 }
 
 static void
@@ -1602,9 +2061,15 @@ cog_drm_platform_set_property(GObject *object, unsigned prop_id, const GValue *v
         if (!self->renderer) {
             update_logical_input_size(self->rotation = rotation);
         } else if (cog_drm_renderer_set_rotation(self->renderer, rotation)) {
+            for (unsigned i = 1; i < self->outputs->len; i++) {
+                CogDrmOutput *output = g_ptr_array_index(self->outputs, i);
+                if (output->renderer && !cog_drm_renderer_set_rotation(output->renderer, rotation))
+                    g_warning("%s: Could not set %u rotation in output %u, unsupported", __func__, rotation, i);
+            }
             update_logical_input_size(self->rotation = rotation);
             if (self->rotatable_input_devices)
                 g_list_foreach(self->rotatable_input_devices, (GFunc) input_configure_device, self);
+            cog_drm_platform_update_views(self, true);
         } else {
             g_critical("%s: Could not set %u rotation (%u degrees), unsupported", __func__, rotation, rotation * 90);
         }
@@ -1655,6 +2120,8 @@ cog_drm_platform_class_init(CogDrmPlatformClass *klass)
     platform_class->setup = cog_drm_platform_setup;
     platform_class->get_view_backend = cog_drm_platform_get_view_backend;
     platform_class->init_web_view = cog_drm_platform_init_web_view;
+    platform_class->viewport_created = cog_drm_platform_viewport_created;
+    platform_class->viewport_disposed = cog_drm_platform_viewport_disposed;
 
     /**
      * CogDrmPlatform:rotation:
@@ -1700,6 +2167,8 @@ cog_drm_platform_class_finalize(CogDrmPlatformClass *klass)
 static void
 cog_drm_platform_init(CogDrmPlatform *self)
 {
+    self->viewports = g_ptr_array_new();
+    self->view_backends = g_ptr_array_new();
 }
 
 G_MODULE_EXPORT void
@@ -67,30 +67,47 @@ static uint32_t convert_rgba_to_pixel_format(uint32_t rgba_pixel, uint32_t forma
     }
 }
 
-struct kms_framebuffer *create_cursor_framebuffer(struct kms_device *device, uint32_t format)
+struct kms_framebuffer *create_cursor_framebuffer(struct kms_device *device,
+                                                  uint32_t format,
+                                                  unsigned int width,
+                                                  unsigned int height)
 {
     struct kms_framebuffer *fb;
-    uint32_t *buf;
+    uint8_t *buf;
 
-    fb = kms_framebuffer_create(device, CURSOR_WIDTH, CURSOR_HEIGHT, format);
+    /* The image goes in the top-left corner, the rest stays transparent. */
+    if (width < CURSOR_WIDTH)
+        width = CURSOR_WIDTH;
+    if (height < CURSOR_HEIGHT)
+        height = CURSOR_HEIGHT;
+
+    fb = kms_framebuffer_create(device, width, height, format);
     if (!fb)
         return NULL;
 
-    if (kms_framebuffer_map(fb, (void *) &buf))
+    if (kms_framebuffer_map(fb, (void *) &buf)) {
+        kms_framebuffer_free(fb);
         return NULL;
+    }
 
     int index;
     uint32_t pixel;
 
     for (int row = 0; row < fb->height; row++) {
+        uint32_t *line = (uint32_t *) (buf + row * fb->pitch);
         for (int column = 0; column < fb->width; column++) {
-            index = (row * fb->width * 4) + (column * 4);
+            if (row >= CURSOR_HEIGHT || column >= CURSOR_WIDTH) {
+                line[column] = 0;
+                continue;
+            }
+
+            index = (row * CURSOR_WIDTH * 4) + (column * 4);
             pixel = (cursorData[index] << 24) +
                     (cursorData[index + 1] << 16) +
                     (cursorData[index + 2] << 8) +
                     cursorData[index + 3];
 
-            *buf++ = convert_rgba_to_pixel_format(pixel, format);
+            line[column] = convert_rgba_to_pixel_format(pixel, format);
         }
     }
 
@@ -9,6 +9,13 @@
 
 #include "kms.h"
 
-struct kms_framebuffer *create_cursor_framebuffer(struct kms_device *device, uint32_t format);
+/*
+ * Creates a framebuffer of at least width x height pixels (the image size
+ * is used if larger) with the cursor image in its top-left corner.
+ */
+struct kms_framebuffer *create_cursor_framebuffer(struct kms_device *device,
+                                                  uint32_t format,
+                                                  unsigned int width,
+                                                  unsigned int height);
 
 #endif //COG_CURSOR_DRM_H
@@ -0,0 +1,207 @@
+/*
+ * cog-headless-egl.c
+ * Copyright (C) 2023 Igalia S.L
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "cog-headless-egl.h"
+
+#include "../../core/cog.h"
+#include <epoxy/gl.h>
+
+/*
+ * The EGL display uses the Mesa surfaceless platform, which picks the
+ * first usable DRM render node (/dev/dri/renderD*) and otherwise falls
+ * back to software rendering with llvmpipe. Setting the environment
+ * variable LIBGL_ALWAYS_SOFTWARE=1 forces the latter.
+ *
+ * Exported images are only read back when needed, by attaching them as
+ * the color buffer of a framebuffer object and using glReadPixels().
+ */
+
+struct _CogHeadlessEgl {
+    EGLDisplay display;
+    EGLContext context;
+    GLuint     texture;
+    GLuint     framebuffer;
+    bool       has_read_format_bgra;
+};
+
+CogHeadlessEgl *
+cog_headless_egl_new(GError **error)
+{
+    if (!epoxy_has_egl_extension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless")) {
+        g_set_error_literal(error, COG_PLATFORM_WPE_ERROR, COG_PLATFORM_WPE_ERROR_INIT,
+                            "EGL extension EGL_MESA_platform_surfaceless missing");
+        return NULL;
+    }
+
+    g_autoptr(CogHeadlessEgl) self = g_new0(CogHeadlessEgl, 1);
+
+    self->display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (self->display == EGL_NO_DISPLAY) {
+        g_set_error_literal(error, COG_PLATFORM_EGL_ERROR, eglGetError(), "Could not open EGL display");
+        return NULL;
+    }
+
+    EGLint major, minor;
+    if (!eglInitialize(self->display, &major, &minor)) {
+        g_set_error_literal(error, COG_PLATFORM_EGL_ERROR, eglGetError(), "eglInitialize");
+        self->display = EGL_NO_DISPLAY;
+        return NULL;
+    }
+    g_debug("%s: EGL %d.%d, %s", G_STRFUNC, major, minor, eglQueryString(self->display, EGL_VENDOR));
+
+    static const char *required_egl_extensions[] = {
+        "EGL_KHR_image_base",
+        "EGL_KHR_surfaceless_context",
+    };
+    for (unsigned i = 0; i < G_N_ELEMENTS(required_egl_extensions); i++) {
+        if (!epoxy_has_egl_extension(self->display, required_egl_extensions[i])) {
+            g_set_error(error, COG_PLATFORM_WPE_ERROR, COG_PLATFORM_WPE_ERROR_INIT, "EGL extension %s missing",
+                        required_egl_extensions[i]);
+            return NULL;
+        }
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_ES_API)) {
+        g_set_error_literal(error, COG_PLATFORM_EGL_ERROR, eglGetError(), "eglBindAPI");
+        return NULL;
+    }
+
+    EGLConfig config = EGL_NO_CONFIG_KHR;
+    if (!epoxy_has_egl_extension(self->display, "EGL_KHR_no_config_context")) {
+        static const EGLint config_attr[] = {
+            EGL_RENDERABLE_TYPE,
+            EGL_OPENGL_ES2_BIT,
+            EGL_NONE,
+        };
+        EGLint matched = 0;
+        if (!eglChooseConfig(self->display, config_attr, &config, 1, &matched) || matched < 1) {
+            g_set_error_literal(error, COG_PLATFORM_EGL_ERROR, eglGetError(), "eglChooseConfig");
+            return NULL;
+        }
+    }
+
+    static const EGLint context_attr[] = {
+        EGL_CONTEXT_CLIENT_VERSION,
+        2,
+        EGL_NONE,
+    };
+    self->context = eglCreateContext(self->display, config, EGL_NO_CONTEXT, context_attr);
+    if (self->context == EGL_NO_CONTEXT) {
+        g_set_error_literal(error, COG_PLATFORM_EGL_ERROR, eglGetError(), "eglCreateContext");
+        return NULL;
+    }
+
+    if (!eglMakeCurrent(self->display, EGL_NO_SURFACE, EGL_NO_SURFACE, self->context)) {
+        g_set_error_literal(error, COG_PLATFORM_EGL_ERROR, eglGetError(), "eglMakeCurrent");
+        return NULL;
+    }
+
+    if (!epoxy_has_gl_extension("GL_OES_EGL_image")) {
+        g_set_error_literal(error, COG_PLATFORM_WPE_ERROR, COG_PLATFORM_WPE_ERROR_INIT,
+                            "GL extension GL_OES_EGL_image missing");
+        return NULL;
+    }
+    self->has_read_format_bgra = epoxy_has_gl_extension("GL_EXT_read_format_bgra");
+
+    glGenTextures(1, &self->texture);
+    glBindTexture(GL_TEXTURE_2D, self->texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &self->framebuffer);
+
+    g_debug("%s: GL renderer %s", G_STRFUNC, glGetString(GL_RENDERER));
+    return g_steal_pointer(&self);
+}
+
+void
+cog_headless_egl_free(CogHeadlessEgl *self)
+{
+    g_return_if_fail(self != NULL);
+
+    if (self->context != EGL_NO_CONTEXT) {
+        if (eglMakeCurrent(self->display, EGL_NO_SURFACE, EGL_NO_SURFACE, self->context)) {
+            if (self->framebuffer)
+                glDeleteFramebuffers(1, &self->framebuffer);
+            if (self->texture)
+                glDeleteTextures(1, &self->texture);
+        }
+        eglMakeCurrent(self->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(self->display, self->context);
+    }
+
+    if (self->display != EGL_NO_DISPLAY)
+        eglTerminate(self->display);
+
+    g_free(self);
+}
+
+EGLDisplay
+cog_headless_egl_get_display(CogHeadlessEgl *self)
+{
+    g_return_val_if_fail(self != NULL, EGL_NO_DISPLAY);
+    return self->display;
+}
+
+/*
+ * Returns the pixels of the image in the same layout as WL_SHM_FORMAT_ARGB8888
+ * buffers, with rows tightly packed. The first row of an image exported by
+ * WebKit is the top of the page, so no flipping is needed.
+ */
+GBytes *
+cog_headless_egl_read_image(CogHeadlessEgl *self, EGLImage image, uint32_t width, uint32_t height, GError **error)
+{
+    g_return_val_if_fail(self != NULL, NULL);
+    g_return_val_if_fail(image != EGL_NO_IMAGE, NULL);
+
+    if (!eglMakeCurrent(self->display, EGL_NO_SURFACE, EGL_NO_SURFACE, self->context)) {
+        g_set_error_literal(error, COG_PLATFORM_EGL_ERROR, eglGetError(), "eglMakeCurrent");
+        return NULL;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, self->texture);
+    glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, image);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, self->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, self->texture, 0);
+
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "Framebuffer incomplete (%#04x)", status);
+        return NULL;
+    }
+
+    const size_t stride = (size_t) width * 4;
+    uint8_t     *pixels = g_malloc(stride * height);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    if (self->has_read_format_bgra) {
+        glReadPixels(0, 0, width, height, GL_BGRA_EXT, GL_UNSIGNED_BYTE, pixels);
+    } else {
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        for (size_t i = 0; i < stride * height; i += 4) {
+            const uint8_t r = pixels[i];
+            pixels[i] = pixels[i + 2];
+            pixels[i + 2] = r;
+        }
+    }
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    const GLenum gl_error = glGetError();
+    if (gl_error != GL_NO_ERROR) {
+        g_free(pixels);
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "glReadPixels failed (%#04x)", gl_error);
+        return NULL;
+    }
+
+    return g_bytes_new_take(pixels, stride * height);
+}
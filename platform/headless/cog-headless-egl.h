@@ -0,0 +1,29 @@
+/*
+ * cog-headless-egl.h
+ * Copyright (C) 2023 Igalia S.L
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <epoxy/egl.h>
+#include <glib.h>
+#include <stdint.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CogHeadlessEgl CogHeadlessEgl;
+
+CogHeadlessEgl *cog_headless_egl_new(GError **error);
+void            cog_headless_egl_free(CogHeadlessEgl *self);
+EGLDisplay      cog_headless_egl_get_display(CogHeadlessEgl *self);
+GBytes         *cog_headless_egl_read_image(CogHeadlessEgl *self,
+                                            EGLImage        image,
+                                            uint32_t        width,
+                                            uint32_t        height,
+                                            GError        **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(CogHeadlessEgl, cog_headless_egl_free)
+
+G_END_DECLS
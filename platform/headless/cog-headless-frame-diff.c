@@ -0,0 +1,194 @@
+/*
+ * cog-headless-frame-diff.c
+ * Copyright (C) 2023 Igalia S.L
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "cog-headless-frame-diff.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#    include <emmintrin.h>
+#endif
+
+/*
+ * Frames are compared by hashing each row of pixels and comparing the
+ * hashes with those of the previous frame. The row hash accumulates
+ * 32-byte stripes into four 64-bit lanes, using the same arithmetic as
+ * the XXH3 accumulation loop (a 32x32->64 multiply of the data mixed with
+ * a key, plus the data with its lanes swapped), which maps directly onto
+ * SSE2 instructions. The portable implementation produces the same
+ * results, and compilers are usually able to auto-vectorize it for other
+ * architectures.
+ */
+
+#define STRIPE_SIZE 32
+
+struct _CogHeadlessFrameDiff {
+    uint32_t  width;
+    uint32_t  height;
+    uint32_t  format;
+    uint64_t *row_hashes;
+};
+
+static const uint64_t s_keys[4] = {
+    0xbe4ba423396cfeb8,
+    0x1cad21f72c81017c,
+    0xdb979083e96dd4de,
+    0x1f67b3b7a4a44072,
+};
+
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+
+static inline uint64_t
+read_u64(const uint8_t *p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline void
+accumulate_stripe_scalar(uint64_t acc[4], const uint8_t *p)
+{
+    uint64_t data[4];
+    for (unsigned i = 0; i < 4; i++)
+        data[i] = read_u64(p + 8 * i);
+
+    for (unsigned i = 0; i < 4; i++) {
+        const uint64_t data_key = data[i] ^ s_keys[i];
+        acc[i] += data[i ^ 1] + (data_key & 0xFFFFFFFF) * (data_key >> 32);
+    }
+}
+
+#if defined(__SSE2__)
+static void
+accumulate_sse2(uint64_t acc[4], const uint8_t *p, size_t n_stripes)
+{
+    const __m128i key_lo = _mm_loadu_si128((const __m128i *) &s_keys[0]);
+    const __m128i key_hi = _mm_loadu_si128((const __m128i *) &s_keys[2]);
+
+    __m128i acc_lo = _mm_loadu_si128((const __m128i *) &acc[0]);
+    __m128i acc_hi = _mm_loadu_si128((const __m128i *) &acc[2]);
+
+    for (size_t i = 0; i < n_stripes; i++, p += STRIPE_SIZE) {
+        const __m128i data_lo = _mm_loadu_si128((const __m128i *) p);
+        const __m128i data_hi = _mm_loadu_si128((const __m128i *) (p + 16));
+
+        const __m128i data_key_lo = _mm_xor_si128(data_lo, key_lo);
+        const __m128i data_key_hi = _mm_xor_si128(data_hi, key_hi);
+
+        const __m128i product_lo = _mm_mul_epu32(data_key_lo, _mm_shuffle_epi32(data_key_lo, _MM_SHUFFLE(0, 3, 0, 1)));
+        const __m128i product_hi = _mm_mul_epu32(data_key_hi, _mm_shuffle_epi32(data_key_hi, _MM_SHUFFLE(0, 3, 0, 1)));
+
+        acc_lo = _mm_add_epi64(acc_lo,
+                               _mm_add_epi64(product_lo, _mm_shuffle_epi32(data_lo, _MM_SHUFFLE(1, 0, 3, 2))));
+        acc_hi = _mm_add_epi64(acc_hi,
+                               _mm_add_epi64(product_hi, _mm_shuffle_epi32(data_hi, _MM_SHUFFLE(1, 0, 3, 2))));
+    }
+
+    _mm_storeu_si128((__m128i *) &acc[0], acc_lo);
+    _mm_storeu_si128((__m128i *) &acc[2], acc_hi);
+}
+#endif /* __SSE2__ */
+
+static inline uint64_t
+avalanche(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t
+cog_headless_frame_diff_hash_row(const void *data, size_t size)
+{
+    uint64_t acc[4] = {PRIME64_3, PRIME64_1, PRIME64_2, PRIME64_3 ^ PRIME64_1};
+
+    const uint8_t *p = data;
+    const size_t   n_stripes = size / STRIPE_SIZE;
+
+#if defined(__SSE2__)
+    accumulate_sse2(acc, p, n_stripes);
+#else
+    for (size_t i = 0; i < n_stripes; i++)
+        accumulate_stripe_scalar(acc, p + i * STRIPE_SIZE);
+#endif /* __SSE2__ */
+
+    /* The remaining bytes are padded with zeroes to a full stripe. */
+    const size_t tail_size = size % STRIPE_SIZE;
+    if (tail_size) {
+        uint8_t tail[STRIPE_SIZE] = {0};
+        memcpy(tail, p + n_stripes * STRIPE_SIZE, tail_size);
+        accumulate_stripe_scalar(acc, tail);
+    }
+
+    uint64_t h = size * PRIME64_1;
+    for (unsigned i = 0; i < 4; i++) {
+        h ^= avalanche(acc[i]);
+        h = ((h << 27) | (h >> 37)) * PRIME64_1;
+    }
+    return avalanche(h);
+}
+
+CogHeadlessFrameDiff *
+cog_headless_frame_diff_new(void)
+{
+    return g_new0(CogHeadlessFrameDiff, 1);
+}
+
+void
+cog_headless_frame_diff_free(CogHeadlessFrameDiff *self)
+{
+    g_return_if_fail(self != NULL);
+
+    g_free(self->row_hashes);
+    g_free(self);
+}
+
+/*
+ * Returns whether the frame is different from the one passed in the
+ * previous call. Only the visible part of each row is hashed, as the
+ * contents of the padding bytes up to the stride are undefined.
+ */
+bool
+cog_headless_frame_diff_update(CogHeadlessFrameDiff *self,
+                               const void           *data,
+                               uint32_t              width,
+                               uint32_t              height,
+                               uint32_t              stride,
+                               uint32_t              format)
+{
+    g_return_val_if_fail(self != NULL, true);
+    g_return_val_if_fail(data != NULL, true);
+
+    bool changed = false;
+    if (!self->row_hashes || self->width != width || self->height != height || self->format != format) {
+        g_free(self->row_hashes);
+        self->row_hashes = g_new(uint64_t, height);
+        self->width = width;
+        self->height = height;
+        self->format = format;
+        changed = true;
+    }
+
+    const uint8_t *row = data;
+    const size_t   row_size = (size_t) width * 4;
+
+    for (uint32_t y = 0; y < height; y++, row += stride) {
+        const uint64_t hash = cog_headless_frame_diff_hash_row(row, row_size);
+        if (self->row_hashes[y] != hash) {
+            self->row_hashes[y] = hash;
+            changed = true;
+        }
+    }
+
+    return changed;
+}
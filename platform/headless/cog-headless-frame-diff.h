@@ -0,0 +1,32 @@
+/*
+ * cog-headless-frame-diff.h
+ * Copyright (C) 2023 Igalia S.L
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CogHeadlessFrameDiff CogHeadlessFrameDiff;
+
+CogHeadlessFrameDiff *cog_headless_frame_diff_new(void);
+void                  cog_headless_frame_diff_free(CogHeadlessFrameDiff *self);
+bool                  cog_headless_frame_diff_update(CogHeadlessFrameDiff *self,
+                                                     const void           *data,
+                                                     uint32_t              width,
+                                                     uint32_t              height,
+                                                     uint32_t              stride,
+                                                     uint32_t              format);
+
+uint64_t cog_headless_frame_diff_hash_row(const void *data, size_t size);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(CogHeadlessFrameDiff, cog_headless_frame_diff_free)
+
+G_END_DECLS
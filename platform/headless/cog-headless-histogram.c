@@ -0,0 +1,85 @@
+/*
+ * cog-headless-histogram.c
+ * Copyright (C) 2023 Igalia S.L
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "cog-headless-histogram.h"
+
+#define SUB_BITS COG_HEADLESS_HISTOGRAM_SUB_BUCKETS_BITS
+#define SUB_MASK (COG_HEADLESS_HISTOGRAM_SUB_BUCKETS - 1)
+
+/*
+ * Values below the number of sub-buckets are stored exactly. Larger values
+ * use the position of their most significant bit to pick a group of
+ * buckets, and the following SUB_BITS bits to pick a bucket in the group.
+ */
+static inline unsigned
+bucket_index(uint64_t value)
+{
+    if (value < COG_HEADLESS_HISTOGRAM_SUB_BUCKETS)
+        return value;
+
+    unsigned exponent = 63 - __builtin_clzll(value);
+    if (exponent > COG_HEADLESS_HISTOGRAM_MAX_EXPONENT)
+        return COG_HEADLESS_HISTOGRAM_N_BUCKETS - 1;
+
+    return ((exponent - SUB_BITS + 1) << SUB_BITS) + ((value >> (exponent - SUB_BITS)) & SUB_MASK);
+}
+
+/* Returns the largest value which maps to the given bucket. */
+static inline int64_t
+bucket_upper_bound(unsigned index)
+{
+    if (index < COG_HEADLESS_HISTOGRAM_SUB_BUCKETS)
+        return index;
+
+    const unsigned exponent = (index >> SUB_BITS) + SUB_BITS - 1;
+    const uint64_t sub_bucket = index & SUB_MASK;
+    return (int64_t) ((((uint64_t) COG_HEADLESS_HISTOGRAM_SUB_BUCKETS + sub_bucket + 1) << (exponent - SUB_BITS)) - 1);
+}
+
+void
+cog_headless_histogram_record(CogHeadlessHistogram *self, int64_t value)
+{
+    g_return_if_fail(self != NULL);
+
+    if (value < 0)
+        value = 0;
+
+    const unsigned index = bucket_index(value);
+    if (G_LIKELY(self->buckets[index] < UINT32_MAX))
+        self->buckets[index]++;
+
+    self->count++;
+    if (value > self->max)
+        self->max = value;
+}
+
+/*
+ * The returned value is the upper bound of the bucket containing the
+ * requested percentile (in the 0-100 range), capped to the maximum
+ * recorded value.
+ */
+int64_t
+cog_headless_histogram_get_percentile(const CogHeadlessHistogram *self, double percentile)
+{
+    g_return_val_if_fail(self != NULL, 0);
+    g_return_val_if_fail(percentile >= 0.0 && percentile <= 100.0, 0);
+
+    if (self->count == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t) (percentile / 100.0 * self->count + 0.5);
+    rank = CLAMP(rank, 1, self->count);
+
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < COG_HEADLESS_HISTOGRAM_N_BUCKETS; i++) {
+        seen += self->buckets[i];
+        if (seen >= rank)
+            return MIN(bucket_upper_bound(i), self->max);
+    }
+
+    return self->max;
+}
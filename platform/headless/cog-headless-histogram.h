@@ -0,0 +1,37 @@
+/*
+ * cog-headless-histogram.h
+ * Copyright (C) 2023 Igalia S.L
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <stdint.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Log-linear histogram of non-negative durations, in microseconds. Each
+ * power of two is split into COG_HEADLESS_HISTOGRAM_SUB_BUCKETS buckets,
+ * which bounds the relative error of percentiles to ~6%, and recording a
+ * value is a constant-time operation which never allocates.
+ */
+#define COG_HEADLESS_HISTOGRAM_SUB_BUCKETS_BITS 4
+#define COG_HEADLESS_HISTOGRAM_SUB_BUCKETS      (1 << COG_HEADLESS_HISTOGRAM_SUB_BUCKETS_BITS)
+#define COG_HEADLESS_HISTOGRAM_MAX_EXPONENT     40
+#define COG_HEADLESS_HISTOGRAM_N_BUCKETS                                                                          \
+    ((COG_HEADLESS_HISTOGRAM_MAX_EXPONENT - COG_HEADLESS_HISTOGRAM_SUB_BUCKETS_BITS + 2) *                         \
+     COG_HEADLESS_HISTOGRAM_SUB_BUCKETS)
+
+typedef struct {
+    uint64_t count;
+    int64_t  max;
+    uint32_t buckets[COG_HEADLESS_HISTOGRAM_N_BUCKETS];
+} CogHeadlessHistogram;
+
+void    cog_headless_histogram_record(CogHeadlessHistogram *self, int64_t value);
+int64_t cog_headless_histogram_get_percentile(const CogHeadlessHistogram *self, double percentile);
+
+G_END_DECLS
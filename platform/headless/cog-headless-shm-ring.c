@@ -0,0 +1,386 @@
+/*
+ * cog-headless-shm-ring.c
+ * Copyright (C) 2023 Igalia S.L
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#define _GNU_SOURCE
+
+#include "cog-headless-shm-ring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <gio/gio.h>
+#include <gio/gunixfdmessage.h>
+#include <gio/gunixsocketaddress.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define ALIGN_TO(value, alignment) (((value) + (alignment) - 1) & ~((size_t) (alignment) - 1))
+
+#define HEADER_SIZE ALIGN_TO(sizeof(struct cog_headless_shm_ring_header), 64)
+
+struct _CogHeadlessShmRing {
+    CogHeadlessShmExporter *exporter;
+
+    uint32_t id;
+    int      fd;
+    size_t   size;
+    void    *data;
+    uint32_t slot_size;
+    uint32_t next_slot;
+    uint64_t sequence;
+};
+
+struct _CogHeadlessShmExporter {
+    GSocketService *service;
+    char           *socket_path;
+
+    unsigned   n_slots;
+    uint32_t   next_ring_id;
+    GPtrArray *rings;   /* CogHeadlessShmRing */
+    GPtrArray *clients; /* GSocketConnection */
+};
+
+static int
+create_anonymous_file(size_t size)
+{
+    int fd;
+
+#ifdef HAVE_MEMFD_CREATE
+    fd = memfd_create("cog-headless-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0)
+        return -1;
+
+    if (ftruncate(fd, size) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    /* Consumers can rely on the mapping never changing size under them. */
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+#else
+    g_autofree char *template = g_build_filename(g_get_user_runtime_dir(), "cog-headless-ring-XXXXXX", NULL);
+    fd = g_mkstemp_full(template, O_RDWR | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return -1;
+
+    g_unlink(template);
+
+    if (ftruncate(fd, size) < 0) {
+        close(fd);
+        return -1;
+    }
+#endif /* HAVE_MEMFD_CREATE */
+
+    return fd;
+}
+
+static bool
+cog_headless_shm_exporter_send(GSocketConnection                          *connection,
+                               const struct cog_headless_shm_ring_message *message,
+                               int                                         fd,
+                               GError                                    **error)
+{
+    g_autoptr(GSocketControlMessage) fd_message = NULL;
+    if (fd >= 0) {
+        fd_message = g_unix_fd_message_new();
+        if (!g_unix_fd_message_append_fd(G_UNIX_FD_MESSAGE(fd_message), fd, error))
+            return false;
+    }
+
+    GOutputVector vector = {message, sizeof(*message)};
+    gssize        sent = g_socket_send_message(g_socket_connection_get_socket(connection),
+                                        NULL,
+                                        &vector,
+                                        1,
+                                        fd_message ? &fd_message : NULL,
+                                        fd_message ? 1 : 0,
+                                        G_SOCKET_MSG_NONE,
+                                        NULL,
+                                        error);
+    return sent == sizeof(*message);
+}
+
+static bool
+cog_headless_shm_exporter_send_ring(GSocketConnection *connection, CogHeadlessShmRing *ring)
+{
+    const struct cog_headless_shm_ring_message message = {
+        .type = COG_HEADLESS_SHM_RING_MESSAGE_RING,
+        .ring_id = ring->id,
+        .value = ring->size,
+    };
+
+    g_autoptr(GError) error = NULL;
+    if (cog_headless_shm_exporter_send(connection, &message, ring->fd, &error))
+        return true;
+
+    g_debug("%s: Dropping consumer %p, %s", G_STRFUNC, connection, error ? error->message : "short write");
+    return false;
+}
+
+/*
+ * Sends a message to all the connected consumers. Consumers which are not
+ * keeping up get FRAME messages dropped, but any other error (including
+ * failing to receive RING messages, which would leave them with a stale
+ * mapping) results in the consumer being disconnected.
+ */
+static void
+cog_headless_shm_exporter_broadcast(CogHeadlessShmExporter                     *self,
+                                    const struct cog_headless_shm_ring_message *message,
+                                    int                                         fd)
+{
+    for (unsigned i = 0; i < self->clients->len;) {
+        GSocketConnection *connection = g_ptr_array_index(self->clients, i);
+
+        g_autoptr(GError) error = NULL;
+        if (cog_headless_shm_exporter_send(connection, message, fd, &error) ||
+            (message->type == COG_HEADLESS_SHM_RING_MESSAGE_FRAME &&
+             g_error_matches(error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))) {
+            i++;
+            continue;
+        }
+
+        g_debug("%s: Dropping consumer %p, %s", G_STRFUNC, connection, error ? error->message : "short write");
+        g_ptr_array_remove_index_fast(self->clients, i);
+    }
+}
+
+static gboolean
+on_cog_headless_shm_exporter_incoming(GSocketService         *service G_GNUC_UNUSED,
+                                      GSocketConnection      *connection,
+                                      GObject                *source_object G_GNUC_UNUSED,
+                                      CogHeadlessShmExporter *self)
+{
+    g_socket_set_blocking(g_socket_connection_get_socket(connection), FALSE);
+
+    for (unsigned i = 0; i < self->rings->len; i++) {
+        CogHeadlessShmRing *ring = g_ptr_array_index(self->rings, i);
+        if (ring->data && !cog_headless_shm_exporter_send_ring(connection, ring))
+            return TRUE;
+    }
+
+    g_debug("%s: New consumer %p", G_STRFUNC, connection);
+    g_ptr_array_add(self->clients, g_object_ref(connection));
+    return TRUE;
+}
+
+static void
+cog_headless_shm_ring_free(CogHeadlessShmRing *self)
+{
+    if (self->data)
+        munmap(self->data, self->size);
+    if (self->fd >= 0)
+        close(self->fd);
+    g_free(self);
+}
+
+CogHeadlessShmExporter *
+cog_headless_shm_exporter_new(const char *socket_path, unsigned n_slots, GError **error)
+{
+    g_return_val_if_fail(socket_path != NULL, NULL);
+    g_return_val_if_fail(n_slots > 1, NULL);
+
+    /* Remove stale sockets left behind by previous instances. */
+    if (g_file_test(socket_path, G_FILE_TEST_EXISTS) && g_unlink(socket_path) != 0) {
+        int errsv = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errsv), "Cannot remove '%s': %s", socket_path,
+                    g_strerror(errsv));
+        return NULL;
+    }
+
+    g_autoptr(GSocketAddress) address = g_unix_socket_address_new(socket_path);
+    g_autoptr(GSocketService) service = g_socket_service_new();
+    if (!g_socket_listener_add_address(G_SOCKET_LISTENER(service), address, G_SOCKET_TYPE_SEQPACKET,
+                                       G_SOCKET_PROTOCOL_DEFAULT, NULL, NULL, error))
+        return NULL;
+
+    CogHeadlessShmExporter *self = g_new0(CogHeadlessShmExporter, 1);
+    self->service = g_steal_pointer(&service);
+    self->socket_path = g_strdup(socket_path);
+    self->n_slots = n_slots;
+    self->next_ring_id = 1;
+    self->rings = g_ptr_array_new_with_free_func((GDestroyNotify) cog_headless_shm_ring_free);
+    self->clients = g_ptr_array_new_with_free_func(g_object_unref);
+
+    g_signal_connect(self->service, "incoming", G_CALLBACK(on_cog_headless_shm_exporter_incoming), self);
+    g_socket_service_start(self->service);
+
+    g_debug("%s: Listening on %s, %u slots per ring", G_STRFUNC, socket_path, n_slots);
+    return self;
+}
+
+void
+cog_headless_shm_exporter_free(CogHeadlessShmExporter *self)
+{
+    g_return_if_fail(self != NULL);
+
+    g_socket_service_stop(self->service);
+    g_socket_listener_close(G_SOCKET_LISTENER(self->service));
+    g_signal_handlers_disconnect_by_data(self->service, self);
+    g_clear_object(&self->service);
+    g_unlink(self->socket_path);
+
+    g_clear_pointer(&self->clients, g_ptr_array_unref);
+    g_clear_pointer(&self->rings, g_ptr_array_unref);
+    g_clear_pointer(&self->socket_path, g_free);
+    g_free(self);
+}
+
+CogHeadlessShmRing *
+cog_headless_shm_exporter_add_ring(CogHeadlessShmExporter *self)
+{
+    g_return_val_if_fail(self != NULL, NULL);
+
+    /* Memory gets allocated on demand, when the frame size is known. */
+    CogHeadlessShmRing *ring = g_new0(CogHeadlessShmRing, 1);
+    ring->exporter = self;
+    ring->id = self->next_ring_id++;
+    ring->fd = -1;
+
+    g_ptr_array_add(self->rings, ring);
+    return ring;
+}
+
+void
+cog_headless_shm_exporter_remove_ring(CogHeadlessShmExporter *self, CogHeadlessShmRing *ring)
+{
+    g_return_if_fail(self != NULL);
+    g_return_if_fail(ring != NULL && ring->exporter == self);
+
+    if (ring->data) {
+        const struct cog_headless_shm_ring_message message = {
+            .type = COG_HEADLESS_SHM_RING_MESSAGE_REMOVED,
+            .ring_id = ring->id,
+        };
+        cog_headless_shm_exporter_broadcast(self, &message, -1);
+    }
+
+    g_ptr_array_remove_fast(self->rings, ring);
+}
+
+bool
+cog_headless_shm_exporter_has_clients(CogHeadlessShmExporter *self)
+{
+    g_return_val_if_fail(self != NULL, false);
+    return self->clients->len > 0;
+}
+
+uint32_t
+cog_headless_shm_ring_get_id(CogHeadlessShmRing *self)
+{
+    g_return_val_if_fail(self != NULL, 0);
+    return self->id;
+}
+
+static bool
+cog_headless_shm_ring_reallocate(CogHeadlessShmRing *self, size_t slot_size)
+{
+    const unsigned n_slots = self->exporter->n_slots;
+    const size_t   size = HEADER_SIZE + slot_size * n_slots;
+
+    if (slot_size > UINT32_MAX) {
+        g_warning("%s: Frame too big (%zu bytes)", G_STRFUNC, slot_size);
+        return false;
+    }
+
+    int fd = create_anonymous_file(size);
+    if (fd < 0) {
+        g_warning("%s: Cannot create shared memory file: %s", G_STRFUNC, g_strerror(errno));
+        return false;
+    }
+
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        g_warning("%s: Cannot map shared memory: %s", G_STRFUNC, g_strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    if (self->data)
+        munmap(self->data, self->size);
+    if (self->fd >= 0)
+        close(self->fd);
+
+    self->fd = fd;
+    self->data = data;
+    self->size = size;
+    self->slot_size = slot_size;
+    self->next_slot = 0;
+
+    struct cog_headless_shm_ring_header *header = self->data;
+    *header = (struct cog_headless_shm_ring_header){
+        .magic = COG_HEADLESS_SHM_RING_MAGIC,
+        .version = COG_HEADLESS_SHM_RING_VERSION,
+        .n_slots = n_slots,
+        .slot_size = slot_size,
+        .slot_offset = HEADER_SIZE,
+        .sequence = self->sequence,
+    };
+
+    g_debug("%s: Ring #%" G_GUINT32_FORMAT ", %u slots of %zu bytes", G_STRFUNC, self->id, n_slots, slot_size);
+
+    const struct cog_headless_shm_ring_message message = {
+        .type = COG_HEADLESS_SHM_RING_MESSAGE_RING,
+        .ring_id = self->id,
+        .value = self->size,
+    };
+    cog_headless_shm_exporter_broadcast(self->exporter, &message, self->fd);
+    return true;
+}
+
+bool
+cog_headless_shm_ring_publish(CogHeadlessShmRing *self,
+                              const void         *data,
+                              uint32_t            width,
+                              uint32_t            height,
+                              uint32_t            stride,
+                              uint32_t            format,
+                              int64_t             timestamp)
+{
+    g_return_val_if_fail(self != NULL, false);
+    g_return_val_if_fail(data != NULL, false);
+
+    const size_t data_size = (size_t) stride * height;
+    const size_t slot_size = ALIGN_TO(COG_HEADLESS_SHM_RING_SLOT_DATA_OFFSET + data_size, 64);
+
+    /* Grow as needed, but avoid shrinking to not reallocate on small resizes. */
+    if (!self->data || slot_size > self->slot_size) {
+        if (!cog_headless_shm_ring_reallocate(self, slot_size))
+            return false;
+    }
+
+    const uint32_t slot = self->next_slot;
+    self->next_slot = (slot + 1) % self->exporter->n_slots;
+
+    struct cog_headless_shm_ring_header *header = self->data;
+    struct cog_headless_shm_ring_slot   *slot_header =
+        (struct cog_headless_shm_ring_slot *) ((uint8_t *) self->data + HEADER_SIZE + (size_t) slot * self->slot_size);
+
+    /* Mark the slot as being written before touching its contents. */
+    __atomic_store_n(&slot_header->sequence, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    slot_header->timestamp = timestamp;
+    slot_header->width = width;
+    slot_header->height = height;
+    slot_header->stride = stride;
+    slot_header->format = format;
+    memcpy((uint8_t *) slot_header + COG_HEADLESS_SHM_RING_SLOT_DATA_OFFSET, data, data_size);
+
+    const uint64_t sequence = ++self->sequence;
+    __atomic_store_n(&slot_header->sequence, sequence, __ATOMIC_RELEASE);
+    __atomic_store_n(&header->sequence, sequence, __ATOMIC_RELEASE);
+
+    const struct cog_headless_shm_ring_message message = {
+        .type = COG_HEADLESS_SHM_RING_MESSAGE_FRAME,
+        .ring_id = self->id,
+        .value = sequence,
+        .slot = slot,
+    };
+    cog_headless_shm_exporter_broadcast(self->exporter, &message, -1);
+    return true;
+}
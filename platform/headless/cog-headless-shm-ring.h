@@ -0,0 +1,95 @@
+/*
+ * cog-headless-shm-ring.h
+ * Copyright (C) 2023 Igalia S.L
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Shared memory layout.
+ *
+ * Each ring is a memfd which starts with a cog_headless_shm_ring_header,
+ * followed by "n_slots" slots of "slot_size" bytes each, the first one
+ * starting at "slot_offset". Each slot starts with a
+ * cog_headless_shm_ring_slot, followed by the pixel data at offset
+ * COG_HEADLESS_SHM_RING_SLOT_DATA_OFFSET from the start of the slot.
+ *
+ * The "sequence" field of a slot is set to zero while its contents are
+ * being written, and to the (non-zero) frame sequence number once they
+ * are complete. Consumers must read it before and after reading the
+ * contents of a slot and discard the frame if the values differ.
+ */
+#define COG_HEADLESS_SHM_RING_MAGIC            0x52474f43 /* "COGR" */
+#define COG_HEADLESS_SHM_RING_VERSION          1
+#define COG_HEADLESS_SHM_RING_SLOT_DATA_OFFSET 64
+
+struct cog_headless_shm_ring_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t n_slots;
+    uint32_t slot_size;
+    uint64_t slot_offset;
+    uint64_t sequence; /* Sequence number of the last published frame. */
+};
+
+struct cog_headless_shm_ring_slot {
+    uint64_t sequence;
+    int64_t  timestamp; /* CLOCK_MONOTONIC or virtual time, in microseconds. */
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint32_t format; /* enum wl_shm_format */
+};
+
+/*
+ * Socket protocol.
+ *
+ * Consumers connect to a SOCK_SEQPACKET UNIX socket, and receive one
+ * cog_headless_shm_ring_message per packet. RING messages carry the
+ * ring memfd as ancillary data (SCM_RIGHTS) and are sent on connection
+ * and whenever a ring gets reallocated, in which case consumers must
+ * replace their previous mapping for the same ring identifier.
+ */
+enum cog_headless_shm_ring_message_type {
+    COG_HEADLESS_SHM_RING_MESSAGE_RING = 1,    /* value: size of the memfd, in bytes. */
+    COG_HEADLESS_SHM_RING_MESSAGE_FRAME = 2,   /* value: frame sequence number. */
+    COG_HEADLESS_SHM_RING_MESSAGE_REMOVED = 3, /* value: unused. */
+};
+
+struct cog_headless_shm_ring_message {
+    uint32_t type;
+    uint32_t ring_id;
+    uint64_t value;
+    uint32_t slot;
+    uint32_t reserved;
+};
+
+typedef struct _CogHeadlessShmExporter CogHeadlessShmExporter;
+typedef struct _CogHeadlessShmRing     CogHeadlessShmRing;
+
+CogHeadlessShmExporter *cog_headless_shm_exporter_new(const char *socket_path, unsigned n_slots, GError **error);
+void                    cog_headless_shm_exporter_free(CogHeadlessShmExporter *self);
+CogHeadlessShmRing     *cog_headless_shm_exporter_add_ring(CogHeadlessShmExporter *self);
+void                    cog_headless_shm_exporter_remove_ring(CogHeadlessShmExporter *self, CogHeadlessShmRing *ring);
+bool                    cog_headless_shm_exporter_has_clients(CogHeadlessShmExporter *self);
+
+uint32_t cog_headless_shm_ring_get_id(CogHeadlessShmRing *self);
+bool     cog_headless_shm_ring_publish(CogHeadlessShmRing *self,
+                                       const void         *data,
+                                       uint32_t            width,
+                                       uint32_t            height,
+                                       uint32_t            stride,
+                                       uint32_t            format,
+                                       int64_t             timestamp);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(CogHeadlessShmExporter, cog_headless_shm_exporter_free)
+
+G_END_DECLS
@@ -6,16 +6,89 @@
  */
 
 #include "../../core/cog.h"
+
+#include "cog-headless-frame-diff.h"
+#include "cog-headless-histogram.h"
+#include "cog-headless-shm-ring.h"
+#if COG_HEADLESS_HAVE_EGL
+#    include "cog-headless-egl.h"
+#    include <wpe/fdo-egl.h>
+#endif /* COG_HEADLESS_HAVE_EGL */
 #include <errno.h>
+#include <float.h>
 #include <glib.h>
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
+#include <wayland-server.h>
 #include <wpe/fdo.h>
 #include <wpe/unstable/fdo-shm.h>
 
+typedef enum {
+    COG_HEADLESS_PACING_TIMER,
+    COG_HEADLESS_PACING_IDLE,
+    COG_HEADLESS_PACING_IMMEDIATE,
+    /* Only exported frames use virtual time, WebKit still uses the real clock. */
+    COG_HEADLESS_PACING_VIRTUAL_TIMESTAMPS,
+} CogHeadlessPacing;
+
+/* All durations in microseconds, measured with the monotonic clock. */
+typedef struct {
+    CogHeadlessHistogram export_interval;
+    CogHeadlessHistogram ack_latency;
+    uint64_t             frames;
+    uint64_t             skipped_frames;
+    uint64_t             dropped_ticks;
+    int64_t              last_export_time;
+} CogHeadlessFrameStats;
+
 struct _CogHeadlessView {
     CogView parent;
 
+    unsigned id; /* Unique among the views created by the platform. */
+
     bool                                    frame_ack_pending;
     struct wpe_view_backend_exportable_fdo *exportable;
+
+    /* Size of the rendered frames, in pixels. */
+    unsigned width;
+    unsigned height;
+    double   device_scale;
+
+    /* Kept until the next frame is exported, to allow capturing it. */
+    struct wpe_fdo_shm_exported_buffer *last_buffer;
+#if COG_HEADLESS_HAVE_EGL
+    struct wpe_fdo_egl_exported_image *last_image;
+#endif /* COG_HEADLESS_HAVE_EGL */
+
+    /*
+     * Each view has its own frame clock, which is a source that only gets
+     * a ready time set while there is a frame acknowledgement pending. An
+     * idle view does not cause any wakeups.
+     */
+    GSource *frame_clock;
+    unsigned max_fps;
+    int64_t  last_frame_ack_time;
+
+    /* Timestamp of the next exported frame, with "virtual-timestamps" pacing. */
+    int64_t virtual_time;
+
+    CogHeadlessShmRing    *shm_ring;
+    CogHeadlessFrameDiff  *frame_diff;
+    CogHeadlessFrameStats *stats;
+};
+
+enum {
+    VIEW_PROP_0,
+    VIEW_PROP_MAX_FPS,
+    VIEW_PROP_WIDTH,
+    VIEW_PROP_HEIGHT,
+    VIEW_PROP_DEVICE_SCALE_FACTOR,
+    VIEW_N_PROPERTIES,
+};
+
+static GParamSpec *s_view_properties[VIEW_N_PROPERTIES] = {
+    NULL,
 };
 
 G_DECLARE_FINAL_TYPE(CogHeadlessView, cog_headless_view, COG, HEADLESS_VIEW, CogView)
@@ -28,10 +101,29 @@ struct _CogHeadlessPlatformClass {
 struct _CogHeadlessPlatform {
     CogPlatform parent;
 
-    unsigned max_fps;
-    unsigned tick_source;
+    CogHeadlessPacing pacing;
+    unsigned          max_fps;
+    int64_t           virtual_step; /* Microseconds, zero for manual stepping. */
+
+    bool use_egl;
+#if COG_HEADLESS_HAVE_EGL
+    CogHeadlessEgl *egl;
+#endif /* COG_HEADLESS_HAVE_EGL */
+
+    unsigned width;
+    unsigned height;
+    double   device_scale;
+
+    bool                    frame_diff;
+    bool                    frame_stats;
+    GSimpleAction          *stats_action;
+    unsigned                stats_update_id;
+    char                   *export_socket_path;
+    unsigned                export_slots;
+    CogHeadlessShmExporter *shm_exporter;
 
     GPtrArray *viewports; /* CogViewport */
+    unsigned   last_view_id;
 };
 
 G_DECLARE_FINAL_TYPE(CogHeadlessPlatform, cog_headless_platform, COG, HEADLESS_PLATFORM, CogPlatform)
@@ -43,18 +135,325 @@ G_DEFINE_DYNAMIC_TYPE_EXTENDED(
     0,
     g_io_extension_point_implement(COG_MODULES_PLATFORM_EXTENSION_POINT, g_define_type_id, "headless", 100);)
 
+static inline CogHeadlessPlatform *
+cog_headless_platform_get(void)
+{
+    return COG_HEADLESS_PLATFORM(cog_platform_get());
+}
+
+static inline double
+usec_to_msec(int64_t usec)
+{
+    return (double) usec / 1000.0;
+}
+
+static GVariant *
+cog_headless_frame_stats_to_variant(const CogHeadlessFrameStats *stats,
+                                    unsigned                     view_id,
+                                    unsigned                     viewport_index,
+                                    unsigned                     view_index)
+{
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+
+    g_variant_builder_add(&builder, "{sv}", "view-id", g_variant_new_uint32(view_id));
+    g_variant_builder_add(&builder, "{sv}", "viewport", g_variant_new_uint32(viewport_index));
+    g_variant_builder_add(&builder, "{sv}", "view", g_variant_new_uint32(view_index));
+
+    g_variant_builder_add(&builder, "{sv}", "frames", g_variant_new_uint64(stats->frames));
+    g_variant_builder_add(&builder, "{sv}", "skipped-frames", g_variant_new_uint64(stats->skipped_frames));
+    g_variant_builder_add(&builder, "{sv}", "dropped-ticks", g_variant_new_uint64(stats->dropped_ticks));
+
+    static const struct {
+        const char *name;
+        double      percentile;
+    } percentiles[] = {
+        {"p50", 50.0},
+        {"p95", 95.0},
+        {"p99", 99.0},
+        {"max", 100.0},
+    };
+    for (unsigned i = 0; i < G_N_ELEMENTS(percentiles); i++) {
+        g_autofree char *interval_key = g_strconcat("interval-", percentiles[i].name, NULL);
+        g_autofree char *latency_key = g_strconcat("ack-latency-", percentiles[i].name, NULL);
+        g_variant_builder_add(&builder, "{sv}", interval_key,
+                              g_variant_new_double(usec_to_msec(cog_headless_histogram_get_percentile(
+                                  &stats->export_interval, percentiles[i].percentile))));
+        g_variant_builder_add(&builder, "{sv}", latency_key,
+                              g_variant_new_double(usec_to_msec(cog_headless_histogram_get_percentile(
+                                  &stats->ack_latency, percentiles[i].percentile))));
+    }
+
+    return g_variant_builder_end(&builder);
+}
+
+static gboolean
+on_cog_headless_platform_stats_update(CogHeadlessPlatform *self)
+{
+    self->stats_update_id = 0;
+
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("aa{sv}"));
+
+    for (unsigned i = 0; i < self->viewports->len; i++) {
+        CogViewport *viewport = g_ptr_array_index(self->viewports, i);
+        for (gsize j = 0; j < cog_viewport_get_n_views(viewport); j++) {
+            CogHeadlessView *view = COG_HEADLESS_VIEW(cog_viewport_get_nth_view(viewport, j));
+            if (view->stats)
+                g_variant_builder_add_value(&builder, cog_headless_frame_stats_to_variant(view->stats, view->id, i, j));
+        }
+    }
+
+    g_simple_action_set_state(self->stats_action, g_variant_builder_end(&builder));
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * The state of the action is refreshed at most once per second, instead of
+ * on every frame, to avoid flooding D-Bus with change notifications. Idle
+ * views do not cause any wakeups.
+ */
+static void
+cog_headless_platform_queue_stats_update(CogHeadlessPlatform *self)
+{
+    if (!self->stats_action || self->stats_update_id)
+        return;
+
+    self->stats_update_id = g_timeout_add_seconds(1, G_SOURCE_FUNC(on_cog_headless_platform_stats_update), self);
+}
+
+/* Unchanged frames are counted as skipped instead, by the caller. */
+static void
+cog_headless_view_record_export(CogHeadlessView *self, bool changed)
+{
+    CogHeadlessFrameStats *stats = self->stats;
+    const int64_t          now = g_get_monotonic_time();
+
+    if (stats->last_export_time)
+        cog_headless_histogram_record(&stats->export_interval, now - stats->last_export_time);
+
+    stats->last_export_time = now;
+    if (changed)
+        stats->frames++;
+}
+
+/*
+ * With timer pacing, a tick is considered dropped for each full frame
+ * period elapsed between the moment the frame should have been acked
+ * (the next tick after it was exported) and the moment it actually was.
+ */
+static void
+cog_headless_view_record_ack(CogHeadlessView *self, int64_t now)
+{
+    CogHeadlessFrameStats *stats = self->stats;
+
+    cog_headless_histogram_record(&stats->ack_latency, now - stats->last_export_time);
+
+    if (cog_headless_platform_get()->pacing == COG_HEADLESS_PACING_TIMER && self->last_frame_ack_time) {
+        const int64_t period = G_USEC_PER_SEC / self->max_fps;
+        const int64_t deadline = MAX(self->last_frame_ack_time + period, stats->last_export_time);
+        if (now - deadline >= period)
+            stats->dropped_ticks += (now - deadline) / period;
+    }
+
+    cog_headless_platform_queue_stats_update(cog_headless_platform_get());
+}
+
+static void
+cog_headless_view_dispatch_frame_complete(CogHeadlessView *self)
+{
+    const int64_t now = g_get_monotonic_time();
+    if (self->stats)
+        cog_headless_view_record_ack(self, now);
+
+    self->frame_ack_pending = false;
+    self->last_frame_ack_time = now;
+    wpe_view_backend_exportable_fdo_dispatch_frame_complete(self->exportable);
+}
+
+static void
+cog_headless_view_schedule_frame_complete(CogHeadlessView *self)
+{
+    switch (cog_headless_platform_get()->pacing) {
+    case COG_HEADLESS_PACING_TIMER:
+        g_source_set_ready_time(self->frame_clock, self->last_frame_ack_time + G_USEC_PER_SEC / self->max_fps);
+        break;
+    case COG_HEADLESS_PACING_IDLE:
+        g_source_set_ready_time(self->frame_clock, 0);
+        break;
+    case COG_HEADLESS_PACING_IMMEDIATE:
+        cog_headless_view_dispatch_frame_complete(self);
+        break;
+    case COG_HEADLESS_PACING_VIRTUAL_TIMESTAMPS:
+        /* With manual stepping frames wait for the advance-virtual-time action. */
+        if (cog_headless_platform_get()->virtual_step > 0)
+            g_source_set_ready_time(self->frame_clock, 0);
+        break;
+    }
+}
+
+static void
+cog_headless_view_advance_virtual_time(CogHeadlessView *self, int64_t step)
+{
+    self->virtual_time += step;
+    if (self->frame_ack_pending)
+        cog_headless_view_dispatch_frame_complete(self);
+}
+
+static inline int64_t
+cog_headless_view_get_frame_timestamp(CogHeadlessView *self)
+{
+    if (cog_headless_platform_get()->pacing == COG_HEADLESS_PACING_VIRTUAL_TIMESTAMPS)
+        return self->virtual_time;
+    return g_get_monotonic_time();
+}
+
+static gboolean
+cog_headless_frame_clock_dispatch(GSource *source, GSourceFunc callback, void *userdata)
+{
+    /* Disarm, the clock gets rescheduled when the next frame is exported. */
+    g_source_set_ready_time(source, -1);
+    return (*callback)(userdata);
+}
+
+static GSourceFuncs s_frame_clock_funcs = {
+    .dispatch = cog_headless_frame_clock_dispatch,
+};
+
+static gboolean
+on_cog_headless_view_frame_clock(CogHeadlessView *self)
+{
+    CogHeadlessPlatform *platform = cog_headless_platform_get();
+    if (platform->pacing == COG_HEADLESS_PACING_VIRTUAL_TIMESTAMPS)
+        cog_headless_view_advance_virtual_time(self, platform->virtual_step);
+    else if (self->frame_ack_pending)
+        cog_headless_view_dispatch_frame_complete(self);
+    return G_SOURCE_CONTINUE;
+}
+
+/*
+ * Returns whether the frame was forwarded to consumers, which is skipped
+ * when frame diffing is enabled and the contents did not change.
+ */
+static bool
+cog_headless_view_export_frame(CogHeadlessView *self,
+                               const void      *data,
+                               uint32_t         width,
+                               uint32_t         height,
+                               uint32_t         stride,
+                               uint32_t         format)
+{
+    const bool changed =
+        !self->frame_diff || cog_headless_frame_diff_update(self->frame_diff, data, width, height, stride, format);
+
+    if (changed && self->shm_ring)
+        cog_headless_shm_ring_publish(self->shm_ring, data, width, height, stride, format,
+                                      cog_headless_view_get_frame_timestamp(self));
+
+    if (!changed) {
+        g_debug("%s: view %p, frame unchanged, skipped", G_STRFUNC, self);
+        if (self->stats)
+            self->stats->skipped_frames++;
+    }
+
+    return changed;
+}
+
+static void
+cog_headless_view_frame_received(CogHeadlessView *self, bool changed)
+{
+    /* The view may have been already disposed, but not yet finalized. */
+    if (G_UNLIKELY(!self->frame_clock))
+        return;
+
+    if (self->stats)
+        cog_headless_view_record_export(self, changed);
+
+    self->frame_ack_pending = true;
+    cog_headless_view_schedule_frame_complete(self);
+}
+
 static void on_export_shm_buffer(void* data, struct wpe_fdo_shm_exported_buffer* buffer)
 {
     CogHeadlessView *view = data;
-    wpe_view_backend_exportable_fdo_dispatch_release_shm_exported_buffer(view->exportable, buffer);
-    view->frame_ack_pending = true;
+    bool             changed = true;
+
+    if (view->frame_diff || view->shm_ring) {
+        struct wl_shm_buffer *shm_buffer = wpe_fdo_shm_exported_buffer_get_shm_buffer(buffer);
+        wl_shm_buffer_begin_access(shm_buffer);
+        changed = cog_headless_view_export_frame(view, wl_shm_buffer_get_data(shm_buffer), wl_shm_buffer_get_width(shm_buffer),
+                                       wl_shm_buffer_get_height(shm_buffer), wl_shm_buffer_get_stride(shm_buffer),
+                                       wl_shm_buffer_get_format(shm_buffer));
+        wl_shm_buffer_end_access(shm_buffer);
+    }
+
+    if (view->last_buffer)
+        wpe_view_backend_exportable_fdo_dispatch_release_shm_exported_buffer(view->exportable, view->last_buffer);
+    view->last_buffer = buffer;
+
+    cog_headless_view_frame_received(view, changed);
+}
+
+#if COG_HEADLESS_HAVE_EGL
+static GBytes *
+cog_headless_view_read_image(CogHeadlessView *self, struct wpe_fdo_egl_exported_image *image)
+{
+    g_autoptr(GError) error = NULL;
+    GBytes           *pixels = cog_headless_egl_read_image(cog_headless_platform_get()->egl,
+                                                           wpe_fdo_egl_exported_image_get_egl_image(image),
+                                                           wpe_fdo_egl_exported_image_get_width(image),
+                                                           wpe_fdo_egl_exported_image_get_height(image),
+                                                           &error);
+    if (!pixels)
+        g_warning("%s: view %p, cannot read back frame: %s", G_STRFUNC, self, error->message);
+    return pixels;
+}
+
+static void
+on_export_egl_image(void *data, struct wpe_fdo_egl_exported_image *image)
+{
+    CogHeadlessView *view = data;
+    bool             changed = true;
+
+    /*
+     * Frames are left in GPU memory unless someone is going to receive
+     * them: reading back is the most expensive part of the process.
+     */
+    if (view->shm_ring && cog_headless_shm_exporter_has_clients(cog_headless_platform_get()->shm_exporter)) {
+        g_autoptr(GBytes) pixels = cog_headless_view_read_image(view, image);
+        if (pixels) {
+            const uint32_t width = wpe_fdo_egl_exported_image_get_width(image);
+            changed = cog_headless_view_export_frame(view, g_bytes_get_data(pixels, NULL), width,
+                                                     wpe_fdo_egl_exported_image_get_height(image), width * 4,
+                                                     WL_SHM_FORMAT_ARGB8888);
+        }
+    }
+
+    if (view->last_image)
+        wpe_view_backend_exportable_fdo_egl_dispatch_release_exported_image(view->exportable, view->last_image);
+    view->last_image = image;
+
+    cog_headless_view_frame_received(view, changed);
 }
+#endif /* COG_HEADLESS_HAVE_EGL */
 
 static void
 on_cog_headless_view_backend_destroy(CogHeadlessView *self)
 {
     g_debug("%s: view %p, exportable %p", G_STRFUNC, self, self->exportable);
     g_assert(self->exportable);
+
+    if (self->last_buffer) {
+        wpe_view_backend_exportable_fdo_dispatch_release_shm_exported_buffer(self->exportable, self->last_buffer);
+        self->last_buffer = NULL;
+    }
+#if COG_HEADLESS_HAVE_EGL
+    if (self->last_image) {
+        wpe_view_backend_exportable_fdo_egl_dispatch_release_exported_image(self->exportable, self->last_image);
+        self->last_image = NULL;
+    }
+#endif /* COG_HEADLESS_HAVE_EGL */
+
     g_clear_pointer(&self->exportable, wpe_view_backend_exportable_fdo_destroy);
 }
 
@@ -63,21 +462,299 @@ cog_headless_view_create_backend(CogView *view)
 {
     CogHeadlessView *self = COG_HEADLESS_VIEW(view);
 
-    static const struct wpe_view_backend_exportable_fdo_client client = {
-        .export_shm_buffer = on_export_shm_buffer,
-    };
+    const uint32_t width = self->width / self->device_scale;
+    const uint32_t height = self->height / self->device_scale;
 
-    self->exportable = wpe_view_backend_exportable_fdo_create(&client, self, 800, 600);
+#if COG_HEADLESS_HAVE_EGL
+    if (cog_headless_platform_get()->egl) {
+        static const struct wpe_view_backend_exportable_fdo_egl_client client = {
+            .export_fdo_egl_image = on_export_egl_image,
+        };
+        self->exportable = wpe_view_backend_exportable_fdo_egl_create(&client, self, width, height);
+    } else
+#endif /* COG_HEADLESS_HAVE_EGL */
+    {
+        static const struct wpe_view_backend_exportable_fdo_client client = {
+            .export_shm_buffer = on_export_shm_buffer,
+        };
+        self->exportable = wpe_view_backend_exportable_fdo_create(&client, self, width, height);
+    }
 
     struct wpe_view_backend *view_backend = wpe_view_backend_exportable_fdo_get_view_backend(self->exportable);
+    wpe_view_backend_dispatch_set_device_scale_factor(view_backend, self->device_scale);
+
     return webkit_web_view_backend_new(view_backend, (GDestroyNotify) on_cog_headless_view_backend_destroy, self);
 }
 
+static GBytes *
+cog_headless_view_capture_frame(CogView *view, unsigned *width, unsigned *height, unsigned *stride)
+{
+    CogHeadlessView *self = COG_HEADLESS_VIEW(view);
+
+#if COG_HEADLESS_HAVE_EGL
+    if (self->last_image) {
+        *width = wpe_fdo_egl_exported_image_get_width(self->last_image);
+        *height = wpe_fdo_egl_exported_image_get_height(self->last_image);
+        *stride = *width * 4;
+        return cog_headless_view_read_image(self, self->last_image);
+    }
+#endif /* COG_HEADLESS_HAVE_EGL */
+
+    if (!self->last_buffer)
+        return NULL;
+
+    struct wl_shm_buffer *shm_buffer = wpe_fdo_shm_exported_buffer_get_shm_buffer(self->last_buffer);
+
+    const uint32_t format = wl_shm_buffer_get_format(shm_buffer);
+    if (format != WL_SHM_FORMAT_ARGB8888 && format != WL_SHM_FORMAT_XRGB8888) {
+        g_warning("%s: Unsupported buffer format %#" PRIx32, G_STRFUNC, format);
+        return NULL;
+    }
+
+    *width = wl_shm_buffer_get_width(shm_buffer);
+    *height = wl_shm_buffer_get_height(shm_buffer);
+    *stride = *width * 4;
+
+    const size_t src_stride = wl_shm_buffer_get_stride(shm_buffer);
+    uint8_t     *pixels = g_malloc((size_t) *stride * *height);
+
+    wl_shm_buffer_begin_access(shm_buffer);
+    const uint8_t *src = wl_shm_buffer_get_data(shm_buffer);
+    for (unsigned y = 0; y < *height; y++) {
+        uint32_t *row = (uint32_t *) (pixels + (size_t) y * *stride);
+        memcpy(row, src + y * src_stride, *stride);
+
+        /* Contents of the padding byte are undefined, make the pixels opaque. */
+        if (format == WL_SHM_FORMAT_XRGB8888) {
+            for (unsigned x = 0; x < *width; x++)
+                row[x] |= 0xFF000000;
+        }
+    }
+    wl_shm_buffer_end_access(shm_buffer);
+
+    return g_bytes_new_take(pixels, (size_t) *stride * *height);
+}
+
+static void
+cog_headless_view_set_max_fps(CogHeadlessView *self, unsigned max_fps)
+{
+    g_return_if_fail(max_fps > 0);
+
+    if (self->max_fps == max_fps)
+        return;
+
+    self->max_fps = max_fps;
+    if (self->frame_ack_pending)
+        cog_headless_view_schedule_frame_complete(self);
+
+    g_object_notify_by_pspec(G_OBJECT(self), s_view_properties[VIEW_PROP_MAX_FPS]);
+}
+
+/*
+ * The view backend takes the size in logical units, which WebKit multiplies
+ * by the device scale factor to obtain the size of the rendered frames.
+ */
+static void
+cog_headless_view_dispatch_size(CogHeadlessView *self)
+{
+    if (!self->exportable)
+        return;
+
+    struct wpe_view_backend *view_backend = wpe_view_backend_exportable_fdo_get_view_backend(self->exportable);
+    wpe_view_backend_dispatch_set_device_scale_factor(view_backend, self->device_scale);
+    wpe_view_backend_dispatch_set_size(view_backend, self->width / self->device_scale,
+                                       self->height / self->device_scale);
+
+    g_debug("%s: view %p, size %ux%u, scale %.2f", G_STRFUNC, self, self->width, self->height, self->device_scale);
+}
+
+static void
+cog_headless_view_set_width(CogHeadlessView *self, unsigned width)
+{
+    g_return_if_fail(width > 0);
+
+    if (self->width == width)
+        return;
+
+    self->width = width;
+    cog_headless_view_dispatch_size(self);
+
+    g_object_notify_by_pspec(G_OBJECT(self), s_view_properties[VIEW_PROP_WIDTH]);
+}
+
+static void
+cog_headless_view_set_height(CogHeadlessView *self, unsigned height)
+{
+    g_return_if_fail(height > 0);
+
+    if (self->height == height)
+        return;
+
+    self->height = height;
+    cog_headless_view_dispatch_size(self);
+
+    g_object_notify_by_pspec(G_OBJECT(self), s_view_properties[VIEW_PROP_HEIGHT]);
+}
+
+static void
+cog_headless_view_set_device_scale(CogHeadlessView *self, double device_scale)
+{
+    g_return_if_fail(device_scale > 0);
+
+    if (fabs(self->device_scale - device_scale) < DBL_EPSILON)
+        return;
+
+    self->device_scale = device_scale;
+    cog_headless_view_dispatch_size(self);
+
+    g_object_notify_by_pspec(G_OBJECT(self), s_view_properties[VIEW_PROP_DEVICE_SCALE_FACTOR]);
+}
+
+static void
+cog_headless_view_get_property(GObject *object, unsigned prop_id, GValue *value, GParamSpec *pspec)
+{
+    CogHeadlessView *self = COG_HEADLESS_VIEW(object);
+    switch (prop_id) {
+    case VIEW_PROP_MAX_FPS:
+        g_value_set_uint(value, self->max_fps);
+        break;
+    case VIEW_PROP_WIDTH:
+        g_value_set_uint(value, self->width);
+        break;
+    case VIEW_PROP_HEIGHT:
+        g_value_set_uint(value, self->height);
+        break;
+    case VIEW_PROP_DEVICE_SCALE_FACTOR:
+        g_value_set_double(value, self->device_scale);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    }
+}
+
+static void
+cog_headless_view_set_property(GObject *object, unsigned prop_id, const GValue *value, GParamSpec *pspec)
+{
+    CogHeadlessView *self = COG_HEADLESS_VIEW(object);
+    switch (prop_id) {
+    case VIEW_PROP_MAX_FPS:
+        cog_headless_view_set_max_fps(self, g_value_get_uint(value));
+        break;
+    case VIEW_PROP_WIDTH:
+        cog_headless_view_set_width(self, g_value_get_uint(value));
+        break;
+    case VIEW_PROP_HEIGHT:
+        cog_headless_view_set_height(self, g_value_get_uint(value));
+        break;
+    case VIEW_PROP_DEVICE_SCALE_FACTOR:
+        cog_headless_view_set_device_scale(self, g_value_get_double(value));
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    }
+}
+
+static void
+cog_headless_view_dump_stats(CogHeadlessView *self)
+{
+    const CogHeadlessFrameStats *stats = self->stats;
+    if (!stats->frames)
+        return;
+
+    g_message("View #%u: %" PRIu64 " frames, %" PRIu64 " unchanged, %" PRIu64 " dropped ticks, "
+              "interval p50/p95/p99 %.2f/%.2f/%.2f ms, ack latency p50/p95/p99 %.2f/%.2f/%.2f ms",
+              self->id, stats->frames, stats->skipped_frames, stats->dropped_ticks,
+              usec_to_msec(cog_headless_histogram_get_percentile(&stats->export_interval, 50.0)),
+              usec_to_msec(cog_headless_histogram_get_percentile(&stats->export_interval, 95.0)),
+              usec_to_msec(cog_headless_histogram_get_percentile(&stats->export_interval, 99.0)),
+              usec_to_msec(cog_headless_histogram_get_percentile(&stats->ack_latency, 50.0)),
+              usec_to_msec(cog_headless_histogram_get_percentile(&stats->ack_latency, 95.0)),
+              usec_to_msec(cog_headless_histogram_get_percentile(&stats->ack_latency, 99.0)));
+}
+
+static void
+cog_headless_view_dispose(GObject *object)
+{
+    CogHeadlessView *self = COG_HEADLESS_VIEW(object);
+
+    if (self->frame_clock) {
+        g_source_destroy(self->frame_clock);
+        g_clear_pointer(&self->frame_clock, g_source_unref);
+    }
+
+    if (self->shm_ring) {
+        cog_headless_shm_exporter_remove_ring(cog_headless_platform_get()->shm_exporter, self->shm_ring);
+        self->shm_ring = NULL;
+    }
+
+    g_clear_pointer(&self->frame_diff, cog_headless_frame_diff_free);
+
+    if (self->stats) {
+        cog_headless_view_dump_stats(self);
+        g_clear_pointer(&self->stats, g_free);
+    }
+
+    G_OBJECT_CLASS(cog_headless_view_parent_class)->dispose(object);
+}
+
 static void
 cog_headless_view_class_init(CogHeadlessViewClass *klass)
 {
+    GObjectClass *object_class = G_OBJECT_CLASS(klass);
+    object_class->dispose = cog_headless_view_dispose;
+    object_class->get_property = cog_headless_view_get_property;
+    object_class->set_property = cog_headless_view_set_property;
+
     CogViewClass *view_class = COG_VIEW_CLASS(klass);
     view_class->create_backend = cog_headless_view_create_backend;
+    view_class->capture_frame = cog_headless_view_capture_frame;
+
+    /**
+     * CogHeadlessView:max-fps:
+     *
+     * Maximum refresh rate for the view, in frames per second. Only used
+     * with the `timer` frame pacing mode. The default value is taken from
+     * the `max-fps` platform parameter.
+     */
+    s_view_properties[VIEW_PROP_MAX_FPS] =
+        g_param_spec_uint("max-fps", NULL, NULL, 1, G_MAXUINT, 30,
+                          G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogHeadlessView:width:
+     *
+     * Width of the rendered frames, in pixels. Changing the value resizes
+     * the view. The default value is taken from the `width` platform
+     * parameter.
+     */
+    s_view_properties[VIEW_PROP_WIDTH] =
+        g_param_spec_uint("width", NULL, NULL, 1, G_MAXINT, 800,
+                          G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogHeadlessView:height:
+     *
+     * Height of the rendered frames, in pixels. Changing the value resizes
+     * the view. The default value is taken from the `height` platform
+     * parameter.
+     */
+    s_view_properties[VIEW_PROP_HEIGHT] =
+        g_param_spec_uint("height", NULL, NULL, 1, G_MAXINT, 600,
+                          G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+    /**
+     * CogHeadlessView:device-scale-factor:
+     *
+     * Device scale factor of the view. The size of the rendered frames is
+     * kept, and the size of the page in logical units is adjusted instead.
+     * The default value is taken from the `device-scale-factor` platform
+     * parameter.
+     */
+    s_view_properties[VIEW_PROP_DEVICE_SCALE_FACTOR] =
+        g_param_spec_double("device-scale-factor", NULL, NULL, 0.05, 64.0, 1.0,
+                            G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+    g_object_class_install_properties(object_class, VIEW_N_PROPERTIES, s_view_properties);
 }
 
 static void
@@ -86,50 +763,307 @@ cog_headless_view_class_finalize(CogHeadlessViewClass *klass G_GNUC_UNUSED)
 }
 
 static void
-cog_headless_view_init(CogHeadlessView *self G_GNUC_UNUSED)
+cog_headless_view_init(CogHeadlessView *self)
+{
+    CogHeadlessPlatform *platform = cog_headless_platform_get();
+
+    self->id = ++platform->last_view_id;
+    self->max_fps = platform->max_fps;
+    self->width = platform->width;
+    self->height = platform->height;
+    self->device_scale = platform->device_scale;
+
+    if (platform->frame_diff)
+        self->frame_diff = cog_headless_frame_diff_new();
+
+    if (platform->frame_stats)
+        self->stats = g_new0(CogHeadlessFrameStats, 1);
+
+    if (platform->shm_exporter) {
+        self->shm_ring = cog_headless_shm_exporter_add_ring(platform->shm_exporter);
+        g_debug("%s: view #%u, frames exported to ring #%" G_GUINT32_FORMAT, G_STRFUNC, self->id,
+                cog_headless_shm_ring_get_id(self->shm_ring));
+    }
+
+    self->frame_clock = g_source_new(&s_frame_clock_funcs, sizeof(GSource));
+    g_source_set_name(self->frame_clock, "Cog headless frame clock");
+    g_source_set_callback(self->frame_clock, G_SOURCE_FUNC(on_cog_headless_view_frame_clock), self, NULL);
+    g_source_set_ready_time(self->frame_clock, -1);
+    g_source_attach(self->frame_clock, NULL);
+}
+
+static void
+cog_headless_platform_set_max_fps(CogHeadlessPlatform *self, const char *value)
+{
+    uint64_t fps = g_ascii_strtoull(value, NULL, 0);
+    if ((fps == UINT64_MAX && errno == ERANGE) || fps == 0 || fps > UINT_MAX)
+        g_warning("Invalid refresh rate value '%s', ignored", value);
+    else
+        self->max_fps = (unsigned) fps;
+}
+
+static void
+cog_headless_platform_set_dimension(const char *value, unsigned *result)
 {
+    uint64_t size = g_ascii_strtoull(value, NULL, 0);
+    if ((size == UINT64_MAX && errno == ERANGE) || size == 0 || size > G_MAXINT)
+        g_warning("Invalid size value '%s', ignored", value);
+    else
+        *result = (unsigned) size;
 }
 
 static void
-cog_headless_view_tick(CogHeadlessView *view)
+cog_headless_platform_set_device_scale(CogHeadlessPlatform *self, const char *value)
 {
-    if (view->frame_ack_pending) {
-        view->frame_ack_pending = false;
-        wpe_view_backend_exportable_fdo_dispatch_frame_complete(view->exportable);
+    char  *end = NULL;
+    double scale = g_ascii_strtod(value, &end);
+    if (end == value || *end != '\0' || scale < 0.05 || scale > 64.0)
+        g_warning("Invalid device scale factor '%s', ignored", value);
+    else
+        self->device_scale = scale;
+}
+
+static void
+cog_headless_platform_set_pacing(CogHeadlessPlatform *self, const char *value)
+{
+    if (g_strcmp0(value, "timer") == 0)
+        self->pacing = COG_HEADLESS_PACING_TIMER;
+    else if (g_strcmp0(value, "idle") == 0)
+        self->pacing = COG_HEADLESS_PACING_IDLE;
+    else if (g_strcmp0(value, "immediate") == 0)
+        self->pacing = COG_HEADLESS_PACING_IMMEDIATE;
+    else if (g_strcmp0(value, "virtual-timestamps") == 0)
+        self->pacing = COG_HEADLESS_PACING_VIRTUAL_TIMESTAMPS;
+    else
+        g_warning("Invalid frame pacing mode '%s', ignored", value);
+}
+
+static void
+cog_headless_platform_set_virtual_step(CogHeadlessPlatform *self, const char *value)
+{
+    uint64_t step = g_ascii_strtoull(value, NULL, 0);
+    if ((step == UINT64_MAX && errno == ERANGE) || step > G_MAXINT64)
+        g_warning("Invalid virtual time step '%s', ignored", value);
+    else
+        self->virtual_step = (int64_t) step;
+}
+
+static void
+cog_headless_platform_set_export_slots(CogHeadlessPlatform *self, const char *value)
+{
+    uint64_t slots = g_ascii_strtoull(value, NULL, 0);
+    if (slots < 2 || slots > 64)
+        g_warning("Invalid number of export slots '%s', ignored", value);
+    else
+        self->export_slots = (unsigned) slots;
+}
+
+static bool
+parse_boolean(const char *value, bool *result)
+{
+    if (g_ascii_strcasecmp(value, "true") == 0 || g_ascii_strcasecmp(value, "yes") == 0 || strcmp(value, "1") == 0)
+        *result = true;
+    else if (g_ascii_strcasecmp(value, "false") == 0 || g_ascii_strcasecmp(value, "no") == 0 ||
+             strcmp(value, "0") == 0)
+        *result = false;
+    else
+        return false;
+    return true;
+}
+
+static void
+cog_headless_platform_set_option(CogHeadlessPlatform *self, const char *key, const char *value)
+{
+    if (g_strcmp0(key, "max-fps") == 0) {
+        cog_headless_platform_set_max_fps(self, value);
+    } else if (g_strcmp0(key, "pacing") == 0) {
+        cog_headless_platform_set_pacing(self, value);
+    } else if (g_strcmp0(key, "virtual-step") == 0) {
+        cog_headless_platform_set_virtual_step(self, value);
+    } else if (g_strcmp0(key, "export-socket") == 0) {
+        g_free(self->export_socket_path);
+        self->export_socket_path = value[0] ? g_strdup(value) : NULL;
+    } else if (g_strcmp0(key, "export-slots") == 0) {
+        cog_headless_platform_set_export_slots(self, value);
+    } else if (g_strcmp0(key, "width") == 0) {
+        cog_headless_platform_set_dimension(value, &self->width);
+    } else if (g_strcmp0(key, "height") == 0) {
+        cog_headless_platform_set_dimension(value, &self->height);
+    } else if (g_strcmp0(key, "device-scale-factor") == 0) {
+        cog_headless_platform_set_device_scale(self, value);
+    } else if (g_strcmp0(key, "renderer") == 0) {
+        if (g_strcmp0(value, "egl") == 0)
+            self->use_egl = true;
+        else if (g_strcmp0(value, "shm") == 0)
+            self->use_egl = false;
+        else
+            g_warning("Invalid renderer '%s', ignored", value);
+    } else if (g_strcmp0(key, "frame-diff") == 0) {
+        if (!parse_boolean(value, &self->frame_diff))
+            g_warning("Invalid frame diffing value '%s', ignored", value);
+    } else if (g_strcmp0(key, "frame-stats") == 0) {
+        if (!parse_boolean(value, &self->frame_stats))
+            g_warning("Invalid frame statistics value '%s', ignored", value);
+    } else {
+        g_warning("Invalid parameter '%s'.", key);
     }
 }
 
 static void
-cog_headless_viewport_tick(CogViewport *viewport)
+cog_headless_platform_init_config(CogHeadlessPlatform *self, CogShell *shell, const char *params_string)
 {
-    cog_viewport_foreach(viewport, (GFunc) cog_headless_view_tick, NULL);
+    double shell_scale = cog_shell_get_device_scale_factor(shell);
+    if (shell_scale > 0)
+        self->device_scale = shell_scale;
+
+    GKeyFile *key_file = cog_shell_get_config_file(shell);
+    if (key_file) {
+        g_auto(GStrv) keys = g_key_file_get_keys(key_file, "headless", NULL, NULL);
+        for (unsigned i = 0; keys && keys[i]; i++) {
+            g_autofree char *value = g_key_file_get_string(key_file, "headless", keys[i], NULL);
+            if (value)
+                cog_headless_platform_set_option(self, keys[i], value);
+        }
+    }
+
+    if (!params_string || params_string[0] == '\0')
+        return;
+
+    /* A single number is still accepted for backwards compatibility. */
+    if (g_ascii_isdigit(params_string[0]) && !strchr(params_string, '=')) {
+        cog_headless_platform_set_max_fps(self, params_string);
+        return;
+    }
+
+    g_auto(GStrv) params = g_strsplit(params_string, ",", 0);
+    for (unsigned i = 0; params[i]; i++) {
+        g_auto(GStrv) kv = g_strsplit(params[i], "=", 2);
+        if (g_strv_length(kv) != 2) {
+            g_warning("Invalid parameter syntax '%s'.", params[i]);
+            continue;
+        }
+
+        cog_headless_platform_set_option(self, g_strstrip(kv[0]), g_strstrip(kv[1]));
+    }
 }
 
-static gboolean
-on_cog_headless_platform_tick(CogHeadlessPlatform *self)
+static void
+on_advance_virtual_time(GSimpleAction *action G_GNUC_UNUSED, GVariant *parameter, CogHeadlessPlatform *self)
 {
-    g_ptr_array_foreach(self->viewports, (GFunc) cog_headless_viewport_tick, NULL);
-    return G_SOURCE_CONTINUE;
+    const int64_t step = MIN(g_variant_get_uint64(parameter), G_MAXINT64);
+
+    for (unsigned i = 0; i < self->viewports->len; i++) {
+        CogViewport *viewport = g_ptr_array_index(self->viewports, i);
+        for (gsize j = 0; j < cog_viewport_get_n_views(viewport); j++)
+            cog_headless_view_advance_virtual_time(COG_HEADLESS_VIEW(cog_viewport_get_nth_view(viewport, j)), step);
+    }
+}
+
+/*
+ * Virtual time can be advanced remotely, which is the only way of making
+ * progress with manual stepping. The action is added to the application,
+ * so it is exposed over D-Bus along with the rest of its actions.
+ */
+static void
+cog_headless_platform_add_virtual_time_action(CogHeadlessPlatform *self)
+{
+    GApplication *app = g_application_get_default();
+    if (!app) {
+        if (self->virtual_step == 0)
+            g_warning("No application to add the advance-virtual-time action to, frames will not be acknowledged");
+        return;
+    }
+
+    g_autoptr(GSimpleAction) action = g_simple_action_new("advance-virtual-time", G_VARIANT_TYPE_UINT64);
+    g_signal_connect_object(action, "activate", G_CALLBACK(on_advance_virtual_time), self, 0);
+    g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(action));
+}
+
+static void
+on_frame_stats_change_state(GSimpleAction *action G_GNUC_UNUSED,
+                            GVariant      *value G_GNUC_UNUSED,
+                            void          *userdata G_GNUC_UNUSED)
+{
+    /* Read-only, the state only gets updated by the plug-in. */
+}
+
+/*
+ * Frame statistics are exposed as the state of an action, which can be
+ * read remotely using the org.gtk.Actions D-Bus interface.
+ */
+static void
+cog_headless_platform_add_stats_action(CogHeadlessPlatform *self)
+{
+    GApplication *app = g_application_get_default();
+    if (!app)
+        return;
+
+    self->stats_action =
+        g_simple_action_new_stateful("frame-stats", NULL, g_variant_new_array(G_VARIANT_TYPE_VARDICT, NULL, 0));
+    g_signal_connect(self->stats_action, "change-state", G_CALLBACK(on_frame_stats_change_state), NULL);
+    g_action_map_add_action(G_ACTION_MAP(app), G_ACTION(self->stats_action));
+}
+
+static bool
+cog_headless_platform_init_egl(CogHeadlessPlatform *self)
+{
+#if COG_HEADLESS_HAVE_EGL
+    g_autoptr(GError) error = NULL;
+    g_autoptr(CogHeadlessEgl) egl = cog_headless_egl_new(&error);
+    if (!egl) {
+        g_warning("Cannot initialize EGL, falling back to SHM: %s", error->message);
+        return false;
+    }
+
+    if (!wpe_fdo_initialize_for_egl_display(cog_headless_egl_get_display(egl))) {
+        g_warning("Cannot initialize WPEBackend-fdo for EGL, falling back to SHM");
+        return false;
+    }
+
+    self->egl = g_steal_pointer(&egl);
+    return true;
+#else
+    g_warning("Built without EGL support, falling back to SHM");
+    return false;
+#endif /* COG_HEADLESS_HAVE_EGL */
 }
 
 static gboolean
-cog_headless_platform_setup(CogPlatform* platform, CogShell* shell G_GNUC_UNUSED, const char* params, GError** error)
+cog_headless_platform_setup(CogPlatform* platform, CogShell* shell, const char* params, GError** error)
 {
     CogHeadlessPlatform *self = COG_HEADLESS_PLATFORM(platform);
 
     wpe_loader_init("libWPEBackend-fdo-1.0.so");
-    wpe_fdo_initialize_shm();
 
-    if (params && params[0] != '\0') {
-        uint64_t value = g_ascii_strtoull(params, NULL, 0);
-        if ((value == UINT64_MAX && errno == ERANGE) || value == 0 || value > UINT_MAX)
-            g_warning("Invalid refresh rate value '%s', ignored", params);
-        else
-            self->max_fps = (unsigned) value;
+    cog_headless_platform_init_config(self, shell, params);
+
+    if (!self->use_egl || !cog_headless_platform_init_egl(self))
+        wpe_fdo_initialize_shm();
+
+    if (self->pacing == COG_HEADLESS_PACING_VIRTUAL_TIMESTAMPS) {
+        if (self->virtual_step < 0)
+            self->virtual_step = G_USEC_PER_SEC / self->max_fps;
+        g_debug("Virtual time step: %" PRId64 " us%s", self->virtual_step,
+                self->virtual_step == 0 ? " (manual)" : "");
+        cog_headless_platform_add_virtual_time_action(self);
+    } else if (self->pacing == COG_HEADLESS_PACING_TIMER) {
+        g_debug("Default maximum refresh rate: %u FPS", self->max_fps);
+    } else {
+        g_debug("Frame pacing: %s, refresh rate unlimited",
+                self->pacing == COG_HEADLESS_PACING_IDLE ? "idle" : "immediate");
+    }
+
+    g_debug("Default view size: %ux%u, scale %.2f", self->width, self->height, self->device_scale);
+
+    if (self->frame_stats)
+        cog_headless_platform_add_stats_action(self);
+
+    if (self->export_socket_path) {
+        self->shm_exporter = cog_headless_shm_exporter_new(self->export_socket_path, self->export_slots, error);
+        if (!self->shm_exporter)
+            return FALSE;
     }
-    g_debug("Maximum refresh rate: %u FPS", self->max_fps);
 
-    self->tick_source = g_timeout_add(1000.0 / self->max_fps, G_SOURCE_FUNC(on_cog_headless_platform_tick), self);
     return TRUE;
 }
 
@@ -138,8 +1072,14 @@ cog_headless_platform_finalize(GObject* object)
 {
     CogHeadlessPlatform *self = COG_HEADLESS_PLATFORM(object);
 
-    g_clear_handle_id(&self->tick_source, g_source_remove);
+    g_clear_handle_id(&self->stats_update_id, g_source_remove);
+    g_clear_object(&self->stats_action);
     g_clear_pointer(&self->viewports, g_ptr_array_unref);
+    g_clear_pointer(&self->shm_exporter, cog_headless_shm_exporter_free);
+#if COG_HEADLESS_HAVE_EGL
+    g_clear_pointer(&self->egl, cog_headless_egl_free);
+#endif /* COG_HEADLESS_HAVE_EGL */
+    g_clear_pointer(&self->export_socket_path, g_free);
 
     G_OBJECT_CLASS(cog_headless_platform_parent_class)->finalize(object);
 }
@@ -188,7 +1128,13 @@ static void
 cog_headless_platform_init(CogHeadlessPlatform* self)
 {
     self->viewports = g_ptr_array_sized_new(3);
+    self->pacing = COG_HEADLESS_PACING_TIMER;
     self->max_fps = 30; /* Default value */
+    self->virtual_step = -1; /* Derived from max_fps. */
+    self->export_slots = 3;
+    self->width = 800;
+    self->height = 600;
+    self->device_scale = 1.0;
 }
 
 G_MODULE_EXPORT void